@@ -0,0 +1,24 @@
+#include <new>
+#include <cstdlib>
+
+#include "allocation_counter.hpp"
+
+static std::atomic<uint64_t> allocations(0);
+
+uint64_t AllocationCounter::Allocations() { 
+  return allocations.load(std::memory_order_relaxed);
+}
+
+// The nothrow variants forward to these. Over-aligned allocations aren't counted:
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ret = std::malloc((size == 0) ? 1 : size)) return ret;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
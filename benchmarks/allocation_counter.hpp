@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+// Counts every call to operator new, in the process. The replacement operators
+// live in allocation_counter.cpp, which declare_benchmark() links into every
+// benchmark.
+//
+// Usage: Create a CountAllocations just before the benchmark loop. When it goes
+// out of scope, it reports the allocations per iteration, as an "allocs" counter:
+//
+//   CountAllocations allocations(state);
+//   for (auto _ : state) ...
+namespace AllocationCounter {
+  uint64_t Allocations();
+}
+
+class CountAllocations {
+  public:
+    explicit CountAllocations(benchmark::State &state) : state(state), 
+      started(AllocationCounter::Allocations()) {}
+    ~CountAllocations() {
+      state.counters["allocs"] = benchmark::Counter(
+        static_cast<double>(AllocationCounter::Allocations()-started), 
+        benchmark::Counter::kAvgIterations);
+    }
+    CountAllocations(const CountAllocations &) = delete;
+    CountAllocations &operator=(const CountAllocations &) = delete;
+
+  private:
+    benchmark::State &state;
+    uint64_t started;
+};
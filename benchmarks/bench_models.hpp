@@ -0,0 +1,87 @@
+#include "model.hpp"
+
+// A model that's wider than most, with a column of every type that we support:
+class WideModel : public Model::Instance<WideModel> { 
+  public :
+    using Model::Instance<WideModel>::Instance;
+
+    MODEL_ACCESSOR(id, long long int)
+    MODEL_ACCESSOR(name, std::string)
+    MODEL_ACCESSOR(email, std::string)
+    MODEL_ACCESSOR(address, std::string)
+    MODEL_ACCESSOR(description, std::string)
+    MODEL_ACCESSOR(is_active, int)
+    MODEL_ACCESSOR(position, int)
+    MODEL_ACCESSOR(price, double)
+    MODEL_ACCESSOR(weight, double)
+    MODEL_ACCESSOR(owner_id, long long int)
+    MODEL_ACCESSOR(parent_id, long long int)
+    MODEL_ACCESSOR(published_at, std::tm)
+    MODEL_ACCESSOR(created_at, std::tm)
+    MODEL_ACCESSOR(updated_at, std::tm)
+
+    inline static Model::Definition Definition {
+      "id",
+      "wide_models", 
+      Model::ColumnTypes( { 
+        {"id",           COL_TYPE(long long int)},
+        {"name",         COL_TYPE(std::string)},
+        {"email",        COL_TYPE(std::string)},
+        {"address",      COL_TYPE(std::string)},
+        {"description",  COL_TYPE(std::string)},
+        {"is_active",    COL_TYPE(int)},
+        {"position",     COL_TYPE(int)},
+        {"price",        COL_TYPE(double)},
+        {"weight",       COL_TYPE(double)},
+        {"owner_id",     COL_TYPE(long long int)},
+        {"parent_id",    COL_TYPE(long long int)},
+        {"published_at", COL_TYPE(std::tm)},
+        {"created_at",   COL_TYPE(std::tm)},
+        {"updated_at",   COL_TYPE(std::tm)}
+      }),
+      Model::Validations()
+    };
+
+    static void Migrate(unsigned int version) {
+      if (version)
+        CreateTable({
+          {"name", "varchar(100)"},
+          {"email", "varchar(100)"},
+          {"address", "varchar(200)"},
+          {"description", "varchar(300)"},
+          {"is_active", "integer"},
+          {"position", "integer"},
+          {"price", "double"},
+          {"weight", "double"},
+          {"owner_id", "bigint"},
+          {"parent_id", "bigint"},
+          {"published_at", "datetime"},
+          {"created_at", "datetime"},
+          {"updated_at", "datetime"}
+        });
+      else
+        DropTable();
+    }
+
+    static Model::Record Sample() {
+      std::tm epoch = prails::utilities::iso8601_to_tm("2020-04-14T16:35:12Z");
+      return Model::Record({
+        {"name", "Wide Model"},
+        {"email", "wide@example.com"},
+        {"address", "1 Infinite Loop, Cupertino, CA 95014"},
+        {"description", "lorem ipsum sit dolor, consectetur adipiscing elit"},
+        {"is_active", (int) 1},
+        {"position", (int) 42},
+        {"price", (double) 19.99},
+        {"weight", (double) 0.75},
+        {"owner_id", (long long int) 1234567},
+        {"parent_id", (long long int) 7654321},
+        {"published_at", epoch},
+        {"created_at", epoch},
+        {"updated_at", epoch}
+      });
+    }
+
+  private:
+    static ModelRegister<WideModel> reg;
+};
@@ -0,0 +1,61 @@
+// Model::Instance<T>::RowToRecord, which converts every row that we select, and
+// recordSet, which coerces values into the types of their columns.
+#include "allocation_counter.hpp"
+#include "model_factory.hpp"
+#include "bench_models.hpp"
+
+using namespace std;
+
+PSYM_MODELS()
+PSYM_MODEL(WideModel)
+
+// The row is selected once, and converted on every iteration. So, this doesn't
+// include the time spent in sqlite:
+static void BM_RowToRecord(benchmark::State& state) {
+  ModelFactory::migrate("WideModel", 1);
+  WideModel model(WideModel::Sample());
+  model.save();
+
+  soci::session sql = ModelFactory::getSession("default");
+  soci::row row;
+  sql << "select * from wide_models limit 1", soci::into(row);
+
+  {
+    CountAllocations allocations(state);
+    for (auto _ : state) benchmark::DoNotOptimize(WideModel::RowToRecord(row));
+  }
+
+  ModelFactory::migrate("WideModel", 0);
+}
+BENCHMARK(BM_RowToRecord);
+
+// Every value is already of its column's type:
+static void BM_RecordSet(benchmark::State& state) {
+  auto record = WideModel::Sample();
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(WideModel(record));
+}
+BENCHMARK(BM_RecordSet);
+
+// Every value needs converting, as they would coming from a form, or from a
+// database that returns numerics as strings:
+static void BM_RecordSetCoerced(benchmark::State& state) {
+  Model::Record record({
+    {"is_active", "1"}, {"position", (long long int) 42}, 
+    {"price", "19.99"}, {"weight", (int) 1}, 
+    {"owner_id", "1234567"}, {"parent_id", (double) 7654321} });
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(WideModel(record));
+}
+BENCHMARK(BM_RecordSetCoerced);
+
+int main(int argc, char** argv) {
+  ModelFactory::Dsn("default", "sqlite3://:memory:", 1);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,34 @@
+// Controller::ModelToJson, which serializes every model that a RestInstance
+// returns.
+#include "allocation_counter.hpp"
+#include "controller.hpp"
+#include "model_factory.hpp"
+#include "bench_models.hpp"
+
+using namespace std;
+
+PSYM_MODELS()
+PSYM_MODEL(WideModel)
+
+static void BM_ModelToJson(benchmark::State& state) {
+  WideModel model(WideModel::Sample());
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(Controller::ModelToJson(model));
+}
+BENCHMARK(BM_ModelToJson);
+
+// An index action, with its array of models:
+static void BM_ModelToJsonArray(benchmark::State& state) {
+  vector<WideModel> models(state.range(0), WideModel(WideModel::Sample()));
+
+  CountAllocations allocations(state);
+  for (auto _ : state) {
+    auto json = nlohmann::json::array();
+    for (auto &model : models) json.push_back(Controller::ModelToJson(model));
+    benchmark::DoNotOptimize(json.dump());
+  }
+}
+BENCHMARK(BM_ModelToJsonArray)->Arg(10)->Arg(100);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,39 @@
+// Controller::PostBody parsing, for the shapes of body that our forms submit.
+#include "allocation_counter.hpp"
+#include "post_body.hpp"
+
+using namespace std;
+
+static void BM_PostBodyFlat(benchmark::State& state) {
+  const string body = "name=New+Task+%26+testing&description=lorem+ipsum+sit+dolor"
+    "&active=1&position=42&price=19.99&updated_at=2020-04-14T16%3A35%3A12Z";
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(Controller::PostBody(body));
+}
+BENCHMARK(BM_PostBodyFlat);
+
+static void BM_PostBodyNestedHash(benchmark::State& state) {
+  const string body = "task[name]=Task&task[owner][name]=Owner&task[owner][id]=1"
+    "&task[owner][address][city]=Brighton&task[owner][address][zip]=BN1"
+    "&task[tags][primary]=one&task[tags][secondary]=two";
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(Controller::PostBody(body));
+}
+BENCHMARK(BM_PostBodyNestedHash);
+
+// The multiple-update and multiple-delete actions receive a collection of ids,
+// with a hash of attributes per id:
+static void BM_PostBodyArray(benchmark::State& state) {
+  string body;
+  for (long i = 0; i < state.range(0); i++)
+    body += fmt::format("{}ids[]={}&tasks[{}][name]=Task+{}&tasks[{}][active]=1",
+      (i == 0) ? "" : "&", i, i, i, i);
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(Controller::PostBody(body));
+}
+BENCHMARK(BM_PostBodyArray)->Arg(1)->Arg(10)->Arg(100);
+
+BENCHMARK_MAIN();
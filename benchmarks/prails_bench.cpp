@@ -0,0 +1,331 @@
+// Measures the throughput, and latency, of the full server stack. We start a
+// Server in-process, with the TasksController from our tests on sqlite, and
+// drive it over keep-alive connections, from a handful of client threads.
+//
+// Each endpoint (index, read, create, static and not_found) is run in turn, once
+// for every value of the server's threads in the sweep. Results are written as
+// json, so that they can be diffed between releases.
+//
+// Usage: prails_bench [--threads 1,2,4] [--connections 16] [--duration 5]
+//   [--warmup 1] [--port 8089] [--output results.json]
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <nlohmann/json.hpp>
+
+#include "server.hpp"
+#include "model_factory.hpp"
+#include "controller_factory.hpp"
+#include "rest_controller_test.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+PSYM_MODELS()
+PSYM_CONTROLLERS()
+PSYM_MODEL(Task)
+PSYM_CONTROLLER(TasksController)
+
+const unsigned int seeded_tasks = 20;
+
+struct Options {
+  vector<unsigned int> threads = {1, 2, 4};
+  unsigned int connections = 16;
+  unsigned int port = 8089;
+  seconds duration = seconds(5);
+  seconds warmup = seconds(1);
+  string output;
+};
+
+struct Endpoint {
+  string name;
+  string method;
+  string path;
+  string body;
+  unsigned int expected_status;
+};
+
+const vector<Endpoint> endpoints = {
+  {"index", "GET", "/tasks", "", 200},
+  {"read", "GET", "/tasks/1", "", 200},
+  {"create", "POST", "/tasks", "name=Bench+Task&description=lorem+ipsum&active=1", 200},
+  {"static", "GET", "/bench.js", "", 200},
+  {"not_found", "GET", "/does-not-exist", "", 404}
+};
+
+// A blocking, keep-alive, HTTP/1.1 client. Just enough of one to read the
+// responses that our Server sends:
+class Connection {
+  public:
+    explicit Connection(unsigned int port) : port(port) {}
+    ~Connection() { disconnect(); }
+
+    // Returns the response status, or 0 if the request failed:
+    unsigned int request(const string &raw) {
+      if ((fd < 0) && !connect()) return 0;
+
+      if (!write_all(raw)) { disconnect(); return 0; }
+
+      size_t header_end;
+      while ((header_end = buffer.find("\r\n\r\n")) == string::npos)
+        if (!fill()) { disconnect(); return 0; }
+
+      string headers = buffer.substr(0, header_end);
+      unsigned int status = (headers.size() > 12) ? stoi(headers.substr(9, 3)) : 0;
+
+      size_t content_length = 0;
+      string lowercase = headers;
+      transform(lowercase.begin(), lowercase.end(), lowercase.begin(), ::tolower);
+      auto length_at = lowercase.find("\r\ncontent-length:");
+      if (length_at != string::npos)
+        content_length = stoul(headers.substr(length_at+17));
+
+      size_t response_size = header_end+4+content_length;
+      while (buffer.size() < response_size)
+        if (!fill()) { disconnect(); return 0; }
+      buffer.erase(0, response_size);
+
+      if (lowercase.find("\r\nconnection: close") != string::npos) disconnect();
+
+      return status;
+    }
+
+  private:
+    unsigned int port;
+    int fd = -1;
+    string buffer;
+
+    bool connect() {
+      fd = socket(AF_INET, SOCK_STREAM, 0);
+      if (fd < 0) return false;
+
+      int nodelay = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(port);
+      inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+      if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        disconnect();
+        return false;
+      }
+      return true;
+    }
+
+    void disconnect() {
+      if (fd >= 0) close(fd);
+      fd = -1;
+      buffer.clear();
+    }
+
+    bool write_all(const string &data) {
+      for (size_t sent = 0; sent < data.size(); ) {
+        ssize_t n = send(fd, data.data()+sent, data.size()-sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+      }
+      return true;
+    }
+
+    bool fill() {
+      char chunk[16384];
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n <= 0) return false;
+      buffer.append(chunk, n);
+      return true;
+    }
+};
+
+string raw_request(const Endpoint &endpoint) {
+  string ret = endpoint.method+" "+endpoint.path+" HTTP/1.1\r\n"
+    "Host: 127.0.0.1\r\nConnection: keep-alive\r\n";
+  if (!endpoint.body.empty())
+    ret += "Content-Type: application/x-www-form-urlencoded\r\n"
+      "Content-Length: "+to_string(endpoint.body.size())+"\r\n";
+  return ret+"\r\n"+endpoint.body;
+}
+
+double percentile(const vector<double> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  return sorted[min(sorted.size()-1, static_cast<size_t>(p * sorted.size()))];
+}
+
+nlohmann::json run(const Endpoint &endpoint, const Options &options) {
+  const string raw = raw_request(endpoint);
+  const auto measure_from = steady_clock::now() + options.warmup;
+  const auto measure_until = measure_from + options.duration;
+
+  vector<vector<double>> samples(options.connections);
+  atomic<uint64_t> errors(0);
+  vector<thread> clients;
+
+  for (unsigned int i = 0; i < options.connections; i++)
+    clients.emplace_back([&, i]() {
+      Connection connection(options.port);
+      for (auto now = steady_clock::now(); now < measure_until; ) {
+        unsigned int status = connection.request(raw);
+        auto finished = steady_clock::now();
+
+        if (now >= measure_from) {
+          if (status == endpoint.expected_status)
+            samples[i].push_back(duration<double, milli>(finished-now).count());
+          else
+            errors++;
+        }
+        now = finished;
+      }
+    });
+
+  for (auto &client : clients) client.join();
+
+  vector<double> all;
+  for (const auto &s : samples) all.insert(all.end(), s.begin(), s.end());
+  sort(all.begin(), all.end());
+
+  return {
+    {"requests", all.size()},
+    {"errors", errors.load()},
+    {"requests_per_second", all.size() / duration<double>(options.duration).count()},
+    {"latency_ms", {
+      {"p50", percentile(all, 0.5)},
+      {"p99", percentile(all, 0.99)},
+      {"p999", percentile(all, 0.999)},
+      {"max", (all.empty()) ? 0 : all.back()} } }
+  };
+}
+
+// Every sweep starts from the same table, so that the index isn't slowed by the
+// tasks that the previous create run left behind. (The table must exist):
+void reset_tasks() {
+  ModelFactory::migrate("Task", 0);
+  ModelFactory::migrate("Task", 1);
+
+  for (unsigned int i = 0; i < seeded_tasks; i++) {
+    time_t now = time(nullptr);
+    Task task({ {"name", "Task "+to_string(i)}, {"active", 1},
+      {"description", "lorem ipsum sit dolor"}, {"created_at", *gmtime(&now)},
+      {"updated_at", *gmtime(&now)} });
+    task.save();
+  }
+}
+
+vector<unsigned int> parse_list(const string &list) {
+  vector<unsigned int> ret;
+  for (size_t start = 0, end; start < list.size(); start = end+1) {
+    end = list.find(',', start);
+    if (end == string::npos) end = list.size();
+    ret.push_back(stoul(list.substr(start, end-start)));
+  }
+  return ret;
+}
+
+Options parse_options(int argc, char *argv[]) {
+  Options ret;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (i+1 >= argc) throw invalid_argument("Missing a value for "+arg);
+    string value = argv[++i];
+
+    if (arg == "--threads") ret.threads = parse_list(value);
+    else if (arg == "--connections") ret.connections = stoul(value);
+    else if (arg == "--duration") ret.duration = seconds(stoul(value));
+    else if (arg == "--warmup") ret.warmup = seconds(stoul(value));
+    else if (arg == "--port") ret.port = stoul(value);
+    else if (arg == "--output") ret.output = value;
+    else throw invalid_argument("Unrecognized argument "+arg);
+  }
+
+  if (ret.threads.empty() || ret.connections == 0)
+    throw invalid_argument("At least one thread, and one connection, are required");
+
+  return ret;
+}
+
+// The server reads its paths relative to the config file. So, we build a small
+// site in a temporary directory:
+string create_site(const Options &options) {
+  auto root = filesystem::temp_directory_path() /
+    ("prails_bench."+to_string(getpid()));
+  filesystem::create_directories(root / "public");
+  filesystem::create_directories(root / "views");
+
+  ofstream(root / "public" / "bench.js") << string(4096, '/') << "\n";
+  ofstream(root / "server.yml") << "port: " << options.port << "\n"
+    << "address: \"127.0.0.1\"\n"
+    << "static_resource_path: \"public\"\n"
+    << "views_path: \"views\"\n"
+    << "config_path: \".\"\n"
+    << "log_level: off\n";
+
+  return root.string();
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  try {
+    options = parse_options(argc, argv);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  string root = create_site(options);
+  ConfigParser config(root+"/server.yml");
+
+  try { spdlog::register_logger(config.setup_logger()); }
+  catch (spdlog::spdlog_ex &e) { /* Do nothing if we already exist */ }
+
+  // Every server thread may hold a session at once. A file database (rather than
+  // :memory:) is shared between the sessions in the pool:
+  ModelFactory::Dsn("default", "sqlite3://db="+root+"/bench.db timeout=5",
+    *max_element(options.threads.begin(), options.threads.end()));
+  ModelFactory::migrate("Task", 1);
+
+  nlohmann::json results = {
+    {"connections", options.connections},
+    {"duration_seconds", options.duration.count()},
+    {"runs", nlohmann::json::array()} };
+
+  for (auto threads : options.threads) {
+    reset_tasks();
+
+    config.threads(threads);
+    auto server = make_unique<Server>(config);
+    server->startThreaded();
+
+    nlohmann::json run_results = { {"threads", threads},
+      {"endpoints", nlohmann::json::object()} };
+
+    for (const auto &endpoint : endpoints) {
+      cerr << "threads=" << threads << " " << endpoint.name << "..." << endl;
+      run_results["endpoints"][endpoint.name] = run(endpoint, options);
+    }
+
+    server->shutdown();
+    results["runs"].push_back(run_results);
+  }
+
+  filesystem::remove_all(root);
+
+  if (options.output.empty())
+    cout << results.dump(2) << endl;
+  else
+    ofstream(options.output) << results.dump(2) << endl;
+
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Controller::Instance::render_html, rendering a view into a layout. The views
+// are written to a temporary directory, at startup.
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include "allocation_counter.hpp"
+#include "controller.hpp"
+
+#include "spdlog/sinks/null_sink.h"
+
+using namespace std;
+
+class RenderController : public Controller::Instance {
+  public:
+    using Controller::Instance::Instance;
+
+    Controller::Response index(nlohmann::json tmpl) { 
+      return render_html("application", "index", tmpl); 
+    }
+};
+
+static string views_path;
+
+static void BM_RenderHtml(benchmark::State& state) {
+  RenderController controller("bench", views_path);
+
+  auto tasks = nlohmann::json::array();
+  for (long i = 0; i < state.range(0); i++)
+    tasks.push_back({ {"id", i}, {"name", fmt::format("Task {}", i)}, 
+      {"description", "lorem ipsum sit dolor"}, {"active", (i % 2 == 0)} });
+
+  CountAllocations allocations(state);
+  for (auto _ : state) 
+    benchmark::DoNotOptimize(controller.index({ {"title", "Tasks"}, {"tasks", tasks} }));
+}
+BENCHMARK(BM_RenderHtml)->Arg(1)->Arg(50);
+
+int main(int argc, char** argv) {
+  auto root = filesystem::temp_directory_path() / 
+    ("render_bench."+to_string(getpid()));
+  filesystem::create_directories(root / "layouts");
+  filesystem::create_directories(root / "bench");
+
+  ofstream(root / "layouts" / "application.inja.html") << 
+    "<!DOCTYPE html>\n<html>\n<head><title>{{ title }}</title></head>\n"
+    "<body class=\"{{ controller }}-{{ action }}\">\n{{ content }}\n</body>\n</html>\n";
+  ofstream(root / "bench" / "index.inja.html") << 
+    "<h1>{{ title }}</h1>\n<ul>\n"
+    "## for task in tasks\n"
+    "  <li id=\"task-{{ task.id }}\" class=\"{% if task.active %}active{% endif %}\">"
+    "{{ task.name }}: {{ task.description }}</li>\n"
+    "## endfor\n</ul>\n";
+
+  views_path = root.string();
+
+  // Controllers need a logger:
+  spdlog::register_logger(make_shared<spdlog::logger>("server", 
+    make_shared<spdlog::sinks::null_sink_mt>()));
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+
+  filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,137 @@
+// Compares request latency, under a cold page cache, for each of the ways that
+// the Server can read a static file on a cache miss.
+//
+// We model a single reactor thread, receiving requests at a fixed rate. One in
+// every cold_ratio requests is for a file that isn't in the page cache. The rest
+// are "hot", and are answered without any I/O (as if from the StaticCache). With
+// the blocking reader, every request queued behind a cold read waits on the disk.
+// With the asynchronous readers, only the cold requests should.
+//
+// Usage: static_reader_bench [directory] [requests] [file_size] [interval_us]
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <condition_variable>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "static_reader.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+const unsigned int cold_ratio = 4;
+
+// Evicts the file from the page cache. The file must be clean (ie fsync'd):
+void evict(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw runtime_error("Unable to open "+path);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+void create(const string &path, size_t size) {
+  string content(size, 'x');
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if ((fd < 0) || (write(fd, content.data(), size) != static_cast<ssize_t>(size)))
+    throw runtime_error("Unable to write "+path);
+  fdatasync(fd);
+  close(fd);
+}
+
+double percentile(vector<double> samples, double p) {
+  if (samples.empty()) return 0;
+  sort(samples.begin(), samples.end());
+  return samples[min(samples.size()-1, static_cast<size_t>(p * samples.size()))];
+}
+
+void run(const string &backend, const vector<string> &paths, unsigned int requests,
+  microseconds interval) {
+  for (const auto &path : paths) evict(path);
+
+  unique_ptr<StaticReader> reader = (backend == "blocking") ? nullptr :
+    StaticReader::Create(backend, 4);
+
+  mutex samples_mutex;
+  condition_variable all_done;
+  vector<double> hot, cold;
+  unsigned int completed = 0;
+  unsigned int failed = 0;
+
+  auto record = [&](vector<double> &samples, steady_clock::time_point arrival, 
+    bool is_ok) {
+    double ms = duration<double, milli>(steady_clock::now() - arrival).count();
+    lock_guard<mutex> guard(samples_mutex);
+    samples.push_back(ms);
+    if (!is_ok) failed++;
+    if (++completed == requests) all_done.notify_one();
+  };
+
+  const auto start = steady_clock::now();
+  for (unsigned int i = 0; i < requests; i++) {
+    auto arrival = start + interval * i;
+    this_thread::sleep_until(arrival);
+
+    if (i % cold_ratio != 0) {
+      record(hot, arrival, true);
+      continue;
+    }
+
+    const string &path = paths[(i / cold_ratio) % paths.size()];
+    if (reader)
+      reader->read(path, [&, arrival](optional<string> content) {
+        record(cold, arrival, content.has_value());
+      });
+    else {
+      ifstream in(path, ios::binary);
+      string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+      record(cold, arrival, !content.empty());
+    }
+  }
+
+  unique_lock<mutex> lock(samples_mutex);
+  all_done.wait(lock, [&] { return completed == requests; });
+
+  cout << backend << (((reader) && (reader->name() != backend)) ? 
+    " (unavailable, used "+reader->name()+")" : "") << ":" << endl
+    << "  hot  p50 " << percentile(hot, 0.5) << "ms, p99 " << percentile(hot, 0.99) 
+    << "ms" << endl
+    << "  cold p50 " << percentile(cold, 0.5) << "ms, p99 " << percentile(cold, 0.99) 
+    << "ms" << endl;
+  if (failed > 0) cout << "  " << failed << " reads failed" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  string dir = (argc > 1) ? argv[1] : 
+    filesystem::temp_directory_path().string()+"/static_reader_bench";
+  unsigned int requests = (argc > 2) ? stoul(argv[2]) : 4000;
+  size_t file_size = (argc > 3) ? stoul(argv[3]) : 256 * 1024;
+  microseconds interval((argc > 4) ? stoul(argv[4]) : 250);
+
+  filesystem::create_directories(dir);
+
+  // Every cold request is for a distinct file, so that no run benefits from the
+  // reads of an earlier request:
+  vector<string> paths;
+  for (unsigned int i = 0; i < requests / cold_ratio + 1; i++) {
+    paths.push_back(dir+"/"+to_string(i)+".bin");
+    create(paths.back(), file_size);
+  }
+
+  cout << requests << " requests, one in " << cold_ratio << " for an uncached " 
+    << file_size << " byte file, every " << interval.count() << "us" << endl;
+
+  for (const auto &backend : {"blocking", "threads", "io_uring"})
+    run(backend, paths, requests, interval);
+
+  filesystem::remove_all(dir);
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+// The prails::utilities helpers that are called on every request.
+#include "allocation_counter.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+static void BM_Split(benchmark::State& state) {
+  const string csv = "GET, POST, PUT, DELETE, OPTIONS, HEAD, PATCH";
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(split(csv, ", "));
+}
+BENCHMARK(BM_Split);
+
+static void BM_Join(benchmark::State& state) {
+  const vector<string> parts = {"GET", "POST", "PUT", "DELETE", "OPTIONS", "HEAD"};
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(join(parts, ", "));
+}
+BENCHMARK(BM_Join);
+
+static void BM_ReplaceAll(benchmark::State& state) {
+  const string haystack = "lorem+ipsum+sit+dolor+consectetur+adipiscing+elit";
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(replace_all(haystack, "+", " "));
+}
+BENCHMARK(BM_ReplaceAll);
+
+static void BM_Iso8601ToTm(benchmark::State& state) {
+  const string iso8601 = "2020-04-14T16:35:12Z";
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(iso8601_to_tm(iso8601));
+}
+BENCHMARK(BM_Iso8601ToTm);
+
+static void BM_TmToIso8601(benchmark::State& state) {
+  const tm tm_time = iso8601_to_tm("2020-04-14T16:35:12Z");
+
+  CountAllocations allocations(state);
+  for (auto _ : state) benchmark::DoNotOptimize(tm_to_iso8601(tm_time));
+}
+BENCHMARK(BM_TmToIso8601);
+
+BENCHMARK_MAIN();
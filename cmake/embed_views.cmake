@@ -0,0 +1,42 @@
+# Generates the translation unit for prails_embed_views(). This runs as a script,
+# at build time, ie:
+#   cmake -DVIEWS_DIR=views -DOUTPUT=embedded_views.cpp -P embed_views.cmake
+file(GLOB_RECURSE views RELATIVE ${VIEWS_DIR} 
+  ${VIEWS_DIR}/*.inja.html ${VIEWS_DIR}/*.inja.js)
+list(SORT views)
+
+set(arrays "")
+set(entries "")
+set(i 0)
+foreach(view ${views})
+  file(READ ${VIEWS_DIR}/${view} hex HEX)
+  string(LENGTH "${hex}" hex_length)
+  math(EXPR size "${hex_length} / 2")
+
+  # Sixteen bytes to a line. These are unsigned, to avoid narrowing, and are
+  # null terminated, though the size excludes the terminator:
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+  string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)"
+    "\\1\n  " bytes "${bytes}")
+
+  string(APPEND arrays "const unsigned char view_${i}[] = {\n  ${bytes}0x00};\n\n")
+  string(APPEND entries "  {\"${view}\", reinterpret_cast<const char *>(view_${i}), ${size}},\n")
+  math(EXPR i "${i} + 1")
+endforeach()
+
+if (i EQUAL 0)
+  set(registrar "EmbeddedViews registrar(nullptr, 0);")
+else()
+  set(registrar "const EmbeddedViews::View views[] = {\n${entries}};\n\n\
+EmbeddedViews registrar(views, sizeof(views)/sizeof(views[0]));")
+endif()
+
+file(WRITE ${OUTPUT} "// Generated by prails_embed_views(), from ${VIEWS_DIR}. Don't edit.
+#include \"embedded_views.hpp\"
+
+namespace {
+
+${arrays}${registrar}
+
+}
+")
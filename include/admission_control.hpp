@@ -0,0 +1,59 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+// Limits the number of requests that are in flight at once. Once the limit is
+// reached, further requests are either shed immediately, or (if a wait queue is
+// configured) held until a request finishes, or until their deadline passes.
+//
+// Admission is lock-free, when there's room. The queue's mutex is only taken when
+// we're at the limit, or when a request finishes while others are waiting. Queued
+// requests never block a thread of theirs. Instead, a dispatcher thread of ours
+// calls their continuation, once a slot is freed, or once their deadline passes.
+// The dispatcher calls these one after another, and can't shed anyone while it's
+// inside of one. So, continuations are expected to hand the request off (ie, to
+// a WorkerPool), rather than run it.
+class AdmissionControl {
+  public:
+    // Called with true when the request is admitted (and must later release()),
+    // or with false when it's shed:
+    typedef std::function<void(bool)> Continuation;
+
+    AdmissionControl(unsigned int, size_t = 0,
+      std::chrono::milliseconds = std::chrono::milliseconds(0));
+    ~AdmissionControl();
+    AdmissionControl(const AdmissionControl &) = delete;
+    AdmissionControl &operator=(const AdmissionControl &) = delete;
+
+    bool try_acquire();
+    void acquire(Continuation);
+    void release();
+
+    unsigned int in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+    unsigned int max_in_flight() const { return max_in_flight_; }
+    size_t waiting() const { return waiting_.load(std::memory_order_relaxed); }
+
+  private:
+    struct Waiter {
+      std::chrono::steady_clock::time_point deadline;
+      Continuation continuation;
+    };
+
+    const unsigned int max_in_flight_;
+    const size_t max_waiting;
+    const std::chrono::milliseconds max_wait;
+    std::atomic<unsigned int> in_flight_{0};
+    std::atomic<size_t> waiting_{0};
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Waiter> waiters;
+    bool is_stopping = false;
+    std::thread dispatcher;
+
+    void dispatch();
+};
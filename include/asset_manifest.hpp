@@ -0,0 +1,50 @@
+#pragma once
+#include <map>
+#include <string>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Maps the static resources (ie "/js/app.js") to fingerprinted resources, which
+// include a digest of their content (ie "/js/app.3f9c1a2b.js"). Since the
+// fingerprinted url changes whenever the content does, clients can cache these
+// forever, and never need to revalidate them.
+//
+// The manifest is built ahead of time, by the "assets" command, and saved as
+// json. When it's loaded, every asset is re-hashed, and any whose content no
+// longer matches its digest, is dropped. As are assets that change while we're 
+// running. Those are then served under their original resource, as before.
+class AssetManifest {
+  public:
+    struct Asset {
+      std::string fingerprinted;
+      std::string digest;
+      size_t size;
+      time_t mtime;
+    };
+
+    explicit AssetManifest(const std::string &);
+
+    void build();
+    void load(const std::string &);
+    void save(const std::string &);
+    void invalidate(const std::string &);
+
+    std::optional<std::string> path_for(const std::string &);
+    std::optional<std::string> resource_for(const std::string &);
+    size_t size();
+
+    static std::string Fingerprint(const std::string &, const std::string &);
+
+    // The number of (hex) digest characters that appear in a fingerprinted url:
+    inline static const size_t FingerprintLength = 10;
+
+  private:
+    std::string root;
+    std::shared_mutex mutex;
+    std::map<std::string, Asset> assets;
+    std::unordered_map<std::string, std::string> resources;
+
+    void insert(const std::string &, const Asset &);
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <map>
 #include <string>
 
 #include "spdlog/spdlog.h"
@@ -6,21 +7,56 @@
 
 class ConfigParser {
   public:
+    // Requests per second, per client. Clients are identified by address, or by
+    // the label of their authorizer, once it's authorized the request:
+    struct RateLimit {
+      double rate;
+      double burst;
+      bool is_by_authorizer;
+    };
+
     explicit ConfigParser(std::string);
     ConfigParser();
     std::string path();
     unsigned int port();
     unsigned int threads();
     unsigned int max_request_size();
+    unsigned int static_cache_size();
+    unsigned int static_cache_max_file_size();
+    unsigned int fragment_cache_size();
+    bool static_gzip();
+    std::string static_reader();
+    unsigned int static_reader_threads();
+    unsigned int workers();
+    unsigned int worker_threads();
+    unsigned int db_pool_size();
+    unsigned int max_in_flight();
+    std::map<std::string, unsigned int> action_max_in_flight();
+    unsigned int admission_queue_size();
+    unsigned int admission_queue_timeout_ms();
+    unsigned int retry_after();
+    std::map<std::string, RateLimit> rate_limits();
+    unsigned int rate_limit_max_clients();
+    std::string reactor_cpus();
+    bool pin_reactors();
+    std::string worker_cpus();
+    std::string background_cpus();
     void threads(unsigned int);
+    void port(unsigned int);
     unsigned int spdlog_queue_size();
     void spdlog_queue_size(unsigned int);
     std::string address();
     std::string static_resource_path();
     std::string views_path();
+    std::string view_cache();
     std::string config_path();
+    std::string asset_manifest();
     std::string dsn();
+    void dsn(const std::string &);
     std::string cors_allow();
+    std::string metrics_path();
+    bool server_timing();
+    unsigned int slow_request_threshold_ms();
     std::string html_error(unsigned int);
 
     std::string log_directory();
@@ -44,15 +80,40 @@ class ConfigParser {
     unsigned int port_;
     unsigned int threads_;
     unsigned int max_request_size_;
+    unsigned int static_cache_size_;
+    unsigned int static_cache_max_file_size_;
+    unsigned int fragment_cache_size_;
+    bool static_gzip_;
+    std::string static_reader_;
+    unsigned int static_reader_threads_;
+    unsigned int workers_;
+    unsigned int worker_threads_;
+    unsigned int db_pool_size_;
+    unsigned int max_in_flight_;
+    std::map<std::string, unsigned int> action_max_in_flight_;
+    unsigned int admission_queue_size_;
+    unsigned int admission_queue_timeout_ms_;
+    unsigned int retry_after_;
+    std::map<std::string, RateLimit> rate_limits_;
+    unsigned int rate_limit_max_clients_;
+    std::string reactor_cpus_;
+    bool pin_reactors_;
+    std::string worker_cpus_;
+    std::string background_cpus_;
     unsigned int spdlog_queue_size_;
     std::string path_;
     std::string address_;
     std::string static_resource_path_;
     std::string views_path_;
     std::string config_path_;
+    std::string asset_manifest_;
     std::string log_level_;
     std::string dsn_;
+    std::string view_cache_;
     std::string cors_allow_;
+    std::string metrics_path_;
+    bool server_timing_;
+    unsigned int slow_request_threshold_ms_;
     std::string log_directory_;
     bool is_logging_to_console_ = false;
     std::string base_path;
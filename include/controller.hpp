@@ -10,6 +10,16 @@
 
 #include "exceptions.hpp"
 #include "config_parser.hpp"
+#include "asset_manifest.hpp"
+#include "metrics.hpp"
+#include "worker_pool.hpp"
+#include "admission_control.hpp"
+#include "rate_limiter.hpp"
+#include "template_cache.hpp"
+#include "fragment_cache.hpp"
+#include "include_store.hpp"
+#include "request_timing.hpp"
+#include "http_header.hpp"
 #include "utilities.hpp"
 #include "post_body.hpp"
 #include "detect.hpp"
@@ -35,6 +45,48 @@ namespace Controller {
     GetConfig((ConfigParser *)&config);
   }
 
+  // The Server sets this, so that views can link to fingerprinted assets:
+  std::shared_ptr<AssetManifest> inline GetAssetManifest(
+    std::shared_ptr<AssetManifest> set_manifest = nullptr) {
+    static std::shared_ptr<AssetManifest> manifest;
+    if (set_manifest != nullptr) manifest = set_manifest;
+    return manifest;
+  }
+
+  // The Server sets this, when actions are to be run off of the reactor threads:
+  std::shared_ptr<WorkerPool> inline GetWorkerPool(
+    std::shared_ptr<WorkerPool> set_pool = nullptr) {
+    static std::shared_ptr<WorkerPool> pool;
+    if (set_pool != nullptr) pool = set_pool;
+    return pool;
+  }
+
+  // The Server sets this, when there's a limit on the requests in flight:
+  std::shared_ptr<AdmissionControl> inline GetAdmissionControl(
+    std::shared_ptr<AdmissionControl> set_admission = nullptr) {
+    static std::shared_ptr<AdmissionControl> admission;
+    if (set_admission != nullptr) admission = set_admission;
+    return admission;
+  }
+
+  // The Server sets this, unless the fragment_cache_size is 0. Fragments are
+  // invalidated with GetFragmentCache()->erase_prefix(), ie from a model's save():
+  std::shared_ptr<FragmentCache> inline GetFragmentCache(
+    std::shared_ptr<FragmentCache> set_fragments = nullptr) {
+    static std::shared_ptr<FragmentCache> fragments;
+    if (set_fragments != nullptr) fragments = set_fragments;
+    return fragments;
+  }
+
+  // The Server sets this, so that include_as_string() needn't read, and escape,
+  // its files on every render:
+  std::shared_ptr<IncludeStore> inline GetIncludeStore(
+    std::shared_ptr<IncludeStore> set_includes = nullptr) {
+    static std::shared_ptr<IncludeStore> includes;
+    if (set_includes != nullptr) includes = set_includes;
+    return includes;
+  }
+
   template <typename T>
   using to_json_t = decltype(std::declval<T>().to_json());
 
@@ -65,20 +117,20 @@ namespace Controller {
 
   class Response {
     public:
-      Response(unsigned int code, const string &content_type, 
-        const string &body) : code_(code), content_type_(content_type), 
-        body_(body) {};
-      Response(unsigned int code, const string &content_type, 
-        const string &body, 
+      // Bodies are taken by value, so that a rendered page is moved in:
+      Response(unsigned int code, const string &content_type, string body) : 
+        code_(code), content_type_(content_type), body_(std::move(body)) {};
+      Response(unsigned int code, const string &content_type, string body, 
         const vector<std::shared_ptr<Http::Header::Header>> &headers) :
-        code_(code), content_type_(content_type), body_(body), headers_(headers) {};
+        code_(code), content_type_(content_type), body_(std::move(body)), 
+        headers_(headers) {};
       explicit Response(nlohmann::json body, unsigned int code = 200) :
         code_(code), content_type_("application/json; charset=utf8"), 
-        body_(body.dump(-1, ' ', false, nlohmann::json::error_handler_t::ignore)) {};
+        body_(Serialize(body)) {};
 
       unsigned int code() { return code_; };
       string content_type() { return content_type_; };
-      string body() { return body_; };
+      const string &body() { return body_; };
 
       void addHeader(std::shared_ptr<Http::Header::Header> header) {
         headers_.push_back(header);
@@ -95,12 +147,21 @@ namespace Controller {
 
         for (const auto & header : headers()) response.headers().add(header);
 
+        if (auto timing = RequestTiming::Current(); timing && timing->is_sending_header())
+          response.headers().add(std::make_shared<prails::HttpHeader>(
+            "Server-Timing", timing->header()));
+
         response.send(static_cast<Http::Code>(code()), body(), 
           Http::Mime::MediaType::fromString(content_type())
         );
       };
 
     protected:
+      static string Serialize(const nlohmann::json &body) {
+        RequestTiming::Timer timer(RequestTiming::Serialization);
+        return body.dump(-1, ' ', false, nlohmann::json::error_handler_t::ignore);
+      }
+
       unsigned int code_;
       string content_type_;
       string body_;
@@ -140,7 +201,14 @@ namespace Controller {
 
       explicit Instance(const string &controller_name, const string &views_path) : 
         controller_name(controller_name), views_path(views_path), 
-        logger(spdlog::get("server")) { 
+        logger(spdlog::get("server")), 
+        is_server_timing(Controller::GetConfig().server_timing()),
+        slow_request_threshold(Controller::GetConfig().slow_request_threshold_ms()),
+        workers(GetWorkerPool()), server_admission(GetAdmissionControl()),
+        retry_after(std::make_shared<prails::HttpHeader>("Retry-After", 
+          std::to_string(Controller::GetConfig().retry_after()))),
+        templates(CreateTemplateCache(Controller::GetConfig().view_cache(), 
+          views_path)) { 
         if (logger == nullptr)
           throw std::runtime_error("Unable to acquire controller logger");
       }
@@ -164,6 +232,22 @@ namespace Controller {
           auto castPtr = std::dynamic_pointer_cast<Cls>(objPtr);
           return (castPtr.get()->*func)(request);
         };
+        objPtr->action_metrics[action] = &Metrics::GetRoute(
+          objPtr->controller_name, action);
+        objPtr->action_shed[action] = &Metrics::GetCounter(fmt::format(
+          "prails_requests_shed_total{{controller=\"{}\",action=\"{}\"}}", 
+          objPtr->controller_name, action), 
+          "Requests refused with a 503, by admission control.");
+
+        auto config = GetConfig();
+        objPtr->bind_rate_limit(action, config);
+
+        auto limits = config.action_max_in_flight();
+        if (auto limit = limits.find(objPtr->controller_name+"#"+action); 
+          (limit != limits.end()) && (limit->second > 0))
+          objPtr->action_admission[action] = std::make_shared<AdmissionControl>(
+            limit->second, config.admission_queue_size(), 
+            std::chrono::milliseconds(config.admission_queue_timeout_ms()));
 
         return [=](const Request &request, 
           Http::ResponseWriter response) {
@@ -173,21 +257,59 @@ namespace Controller {
       }
 
       map<string, Action> actions;
+      map<string, Metrics::Route *> action_metrics;
+      map<string, Metrics::Counter *> action_shed;
+      map<string, std::shared_ptr<AdmissionControl>> action_admission;
+
+      struct RateLimit {
+        std::shared_ptr<RateLimiter> limiter;
+        bool is_by_authorizer;
+        std::shared_ptr<prails::HttpHeader> retry_after;
+        Metrics::Counter *limited;
+      };
+      map<string, RateLimit> action_rate_limits;
+      map<string, std::shared_ptr<RateLimiter>> rate_limiters;
 
     protected:
       std::shared_ptr<spdlog::logger> logger;
+      bool is_server_timing;
+      std::chrono::milliseconds slow_request_threshold;
+      std::shared_ptr<WorkerPool> workers;
+      std::shared_ptr<AdmissionControl> server_admission;
+      std::shared_ptr<prails::HttpHeader> retry_after;
+      std::shared_ptr<TemplateCache> templates;
+      static std::shared_ptr<TemplateCache> CreateTemplateCache(const string &,
+        const string &);
+      static optional<string_view> FindEmbeddedView(const string &, 
+        const string &);
       string ensure_view_file(string, string);
       string ensure_view_file(string);
       string ensure_view_folder(string, string);
       string ensure_view_folder(string);
       void ensure_content_type(const Request &, Http::Mime::MediaType);
 
+      // Identifies the client, for rate limits that are keyed by authorizer.
+      // Controllers with an authorizer should return its label (RestInstance 
+      // does), but only once it's authorized the action. Otherwise, clients are
+      // identified by their address. Exceptions are handled as run_action()'s
+      // are:
+      virtual optional<string> rate_limit_key(const Request &, const string &) { 
+        return nullopt; 
+      }
+
       template <typename TAuthorizer>
-      TAuthorizer ensure_authorization(const Request& req, const string &action) {
+      optional<TAuthorizer> fetch_authorizer(const Request& req) {
         auto auth_header = req.headers().tryGet<Http::Header::Authorization>();
 
-        optional<TAuthorizer> auth = TAuthorizer::FromHeader( 
+        return TAuthorizer::FromHeader( 
           (auth_header) ? make_optional<string>(auth_header->value()) : nullopt);
+      }
+
+      template <typename TAuthorizer>
+      TAuthorizer ensure_authorization(const Request& req, const string &action) {
+        RequestTiming::Timer timer(RequestTiming::Authorization);
+
+        optional<TAuthorizer> auth = fetch_authorizer<TAuthorizer>(req);
 
         if (!auth.has_value())
           throw AccessDenied("Unable to fetch authorizer from Provided Header",
@@ -226,6 +348,11 @@ namespace Controller {
         );
       }
 
+      void bind_rate_limit(const string &, ConfigParser &);
+      void run_action(const string &, const Request&, Http::ResponseWriter);
+      void send_shed_response(const string &, Http::ResponseWriter &);
+      void log_slow_request(const Request&, const string &, Http::Code, 
+        const RequestTiming &);
       void send_fatal_response(Http::ResponseWriter &, const Request&, Pistache::Http::Code, const string);
   };
 }
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// A set of cpus, in the format that taskset and the kernel's cpulist files use:
+// "0-3,8,10-11". Threads pinned to a set will only be scheduled on those cpus.
+// Threads that are created by a pinned thread, inherit its set.
+class CpuSet {
+  public:
+    CpuSet() {}
+    explicit CpuSet(const std::string &);
+
+    // A tid of 0 is the calling thread. Returns false if the thread has since 
+    // exited:
+    bool pin(pid_t = 0) const;
+    static CpuSet OfThread(pid_t = 0);
+
+    // The tid of the calling thread:
+    static pid_t CurrentThread();
+
+    bool empty() const { return cpus_.empty(); }
+    size_t size() const { return cpus_.size(); }
+    const std::vector<unsigned int> &cpus() const { return cpus_; }
+    CpuSet at(size_t) const;
+    std::string to_string() const;
+
+  private:
+    std::vector<unsigned int> cpus_;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <map>
+#include <string>
+#include <optional>
+#include <string_view>
+
+// Views that were compiled into the binary, by the prails_embed_views() cmake
+// function. The translation unit that it generates registers its views here, 
+// during static initialization. Paths are relative to the views directory (ie, 
+// "layouts/default.inja.html").
+class EmbeddedViews {
+  public:
+    struct View {
+      const char *path;
+      const char *content;
+      size_t size;
+    };
+
+    EmbeddedViews(const View *, size_t);
+
+    static std::optional<std::string_view> Find(const std::string &);
+    static size_t Size() { return Views().size(); }
+
+  private:
+    // A function-local static, since registration happens before main():
+    static std::map<std::string, std::string_view> &Views();
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// Watches a directory tree via inotify, and dispatches the full path of any
+// entry that was created, modified, moved or deleted to the subscribers.
+// Subdirectories created after start() are picked up automatically.
+class FileWatcher {
+  public:
+    typedef std::function<void(const std::string &)> Callback;
+
+    explicit FileWatcher(const std::string &);
+    ~FileWatcher();
+
+    void subscribe(Callback);
+    void start();
+    void stop();
+    bool is_running() { return running; }
+
+  private:
+    // We're woken by stop_fd when stopped. This is just a backstop for when we
+    // couldn't be:
+    inline static const int StopPollMs = 1000;
+
+    std::string root;
+    int inotify_fd = -1;
+    int stop_fd = -1;
+    std::atomic<bool> running{false};
+    std::thread watcher;
+    std::mutex subscribers_mutex;
+    std::vector<Callback> subscribers;
+    std::map<int, std::string> watch_paths;
+
+    bool signal_stop() noexcept;
+    void watch_tree(const std::string &);
+    void watch_loop();
+    void dispatch(const std::string &);
+};
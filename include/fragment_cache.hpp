@@ -0,0 +1,56 @@
+#pragma once
+#include <map>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <string>
+#include <optional>
+#include <functional>
+
+// Rendered fragments of views (ie, navigation, or sidebars), shared by every 
+// controller, and every thread. Fragments expire after their ttl, and the least
+// recently used are evicted, once the cache exceeds its size in bytes. 
+//
+// Fragments are invalidated by key prefix. So, keys like "tasks/sidebar" can be 
+// cleared by a model's save(), with erase_prefix("tasks/").
+class FragmentCache {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit FragmentCache(size_t);
+
+    std::optional<std::string> get(const std::string &);
+    void set(const std::string &, std::string, std::chrono::seconds);
+
+    // Returns the cached fragment, or else renders it, and caches that. The 
+    // render is run outside of our lock, so that it may itself use the cache. 
+    // Concurrent fetches of a fragment that's being rendered, wait on that 
+    // render's result:
+    std::string fetch(const std::string &, std::chrono::seconds, 
+      const std::function<std::string()> &);
+
+    size_t erase_prefix(const std::string &);
+    void clear();
+
+    size_t size();
+    size_t bytes();
+
+  private:
+    struct Fragment {
+      std::string value;
+      Clock::time_point expires_at;
+      std::list<std::string>::iterator used;
+    };
+
+    size_t max_bytes;
+    size_t bytes_ = 0;
+    std::mutex mutex;
+    std::map<std::string, Fragment> fragments;
+    std::list<std::string> used; // Most recently used, first
+    std::map<std::string, std::shared_future<std::string>> renders;
+
+    static size_t Footprint(const std::string &, const std::string &);
+    void erase(std::map<std::string, Fragment>::iterator);
+    void finish(const std::string &);
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <map>
+#include <string>
+#include <optional>
+
+// A blocking, keep-alive, HTTP/1.1 connection. This is how we talk to a Server
+// that's running in our own process (ie, when exporting pages), without paying
+// for a new connection, or a new process, on every request.
+//
+// Responses may be sized by a Content-Length, or chunked. If a kept-alive
+// connection was closed by the server before it responded, the request is
+// retried once, on a new connection.
+class HttpConnection {
+  public:
+    struct Response {
+      int status = 0;
+      std::map<std::string, std::string> headers; // Names are lowercased
+      std::string body;
+
+      std::optional<std::string> header(const std::string &) const;
+    };
+
+    HttpConnection(const std::string &, unsigned int);
+    ~HttpConnection();
+    HttpConnection(const HttpConnection &) = delete;
+    HttpConnection &operator=(const HttpConnection &) = delete;
+
+    // Throws a runtime_error if the server can't be reached, or if the response
+    // is malformed:
+    Response request(const std::string &, const std::string &,
+      const std::string & = std::string(),
+      const std::map<std::string, std::string> & = {});
+
+    bool is_connected() const { return fd >= 0; }
+
+  private:
+    std::string host;
+    unsigned int port;
+    int fd = -1;
+    std::string buffer;
+
+    void connect();
+    void disconnect();
+    bool write_all(const std::string &);
+    bool fill();
+    std::string read_line();
+    std::string read_bytes(size_t);
+    Response read_response(bool);
+};
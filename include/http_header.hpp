@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <ostream>
+
+#include <pistache/http_headers.h>
+
+namespace prails {
+  // Pistache only offers classes for a handful of headers, and only writes the
+  // typed headers in a response's collection. This lets us send any header by
+  // name, the same way as we'd send one of pistache's.
+  class HttpHeader : public Pistache::Http::Header::Header {
+    public:
+      HttpHeader(const std::string &name, const std::string &value) : 
+        name_(name), value_(value) {}
+
+      const char *name() const override { return name_.c_str(); }
+      void parse(const std::string &data) override { value_ = data; }
+      void write(std::ostream &os) const override { os << value_; }
+
+      std::string value() const { return value_; }
+
+    private:
+      std::string name_;
+      std::string value_;
+  };
+}
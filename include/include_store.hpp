@@ -0,0 +1,41 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <optional>
+#include <string_view>
+#include <shared_mutex>
+
+// The files that views inline with include_as_string(), loaded once, and stored 
+// already escaped (as a JSON string). Lookups are shared, and only a miss takes
+// our lock exclusively. Large files are escaped straight from a mapping of the 
+// file, rather than being read into a buffer first.
+//
+// Nothing here goes stale on its own. The Server invalidates files as they 
+// change, when the views are watched (development).
+class IncludeStore {
+  public:
+    typedef std::shared_ptr<const std::string> Escaped;
+
+    // Files at least this large are mapped, rather than read:
+    static constexpr size_t MinMappedSize = 64 * 1024;
+
+    // If provided, the content is escaped in place of the file's (ie, for 
+    // views that were compiled into the binary):
+    Escaped get(const std::string &, 
+      std::optional<std::string_view> = std::nullopt);
+
+    // The path may be a file, or a directory of files:
+    void invalidate(const std::string &);
+    void clear();
+    size_t size();
+
+    static std::string Escape(std::string_view);
+
+  private:
+    std::shared_mutex mutex;
+    std::map<std::string, Escaped> files;
+    unsigned long generation = 0;
+
+    static std::string Load(const std::string &);
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+// A read-only, private memory mapping of a file. This lets us hand slices of a 
+// file to the kernel, without first read()'ing them into a buffer of our own.
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string &);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool is_mapped() const { return data_ != nullptr; }
+
+  private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <functional>
+
+// Counters and latency histograms, exported in the Prometheus text format.
+//
+// Every metric is sharded, with each thread incrementing its own (cache-line
+// aligned) shard, using relaxed atomics. Nothing is aggregated until Scrape() is
+// called, so that recording a request costs a handful of uncontended increments.
+//
+// Metrics are registered by name, and live until the process exits. So, the
+// references returned by GetCounter(), GetHistogram() and GetRoute() can (and
+// should) be held onto, rather than looked up per request.
+class Metrics {
+  public:
+    static const size_t NumShards = 8;
+
+    class Counter {
+      public:
+        void increment(uint64_t by = 1) {
+          shards[ShardIndex()].value.fetch_add(by, std::memory_order_relaxed);
+        }
+        uint64_t value() const;
+
+      private:
+        struct alignas(64) Shard { std::atomic<uint64_t> value{0}; };
+        std::array<Shard, NumShards> shards;
+    };
+
+    // An HDR-style, log-linear histogram of microseconds. Values below 16 each
+    // have their own bucket. Above that, every power of two is split into 8
+    // buckets, which bounds the error on any recorded value to 12.5%.
+    class Histogram {
+      public:
+        static const size_t NumBuckets = 16 + 32 * 8;
+
+        void observe(uint64_t);
+        uint64_t count() const;
+        uint64_t sum() const;
+        std::array<uint64_t, NumBuckets> buckets() const;
+
+        static size_t BucketIndex(uint64_t);
+        static uint64_t BucketUpperBound(size_t);
+
+      private:
+        struct alignas(64) Shard {
+          std::atomic<uint64_t> count{0};
+          std::atomic<uint64_t> sum{0};
+          std::array<std::atomic<uint64_t>, NumBuckets> buckets{};
+        };
+        std::array<Shard, NumShards> shards;
+    };
+
+    // Records the time from its construction, until its destruction:
+    class ScopedTimer {
+      public:
+        explicit ScopedTimer(Histogram &histogram) : histogram(histogram),
+          started(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+          histogram.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now()-started).count());
+        }
+
+      private:
+        Histogram &histogram;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    // The latencies of a controller#action, by response status. A histogram is
+    // allocated the first time that a status is seen, and is never freed:
+    class Route {
+      public:
+        Route() {}
+        ~Route();
+        Route(const Route &) = delete;
+        Route &operator=(const Route &) = delete;
+
+        void record(unsigned int, uint64_t);
+        const Histogram *status(unsigned int) const;
+
+        static const unsigned int MinStatus = 100;
+        static const unsigned int MaxStatus = 599;
+
+      private:
+        std::array<std::atomic<Histogram *>, MaxStatus-MinStatus+1> statuses{};
+    };
+
+    static Counter &GetCounter(const std::string &, const std::string &);
+    static Histogram &GetHistogram(const std::string &, const std::string &);
+    static Route &GetRoute(const std::string &, const std::string &);
+    static void SetGauge(const std::string &, const std::string &,
+      std::function<double()>);
+
+    static std::string Scrape();
+
+    // The upper bounds (in seconds) of the histogram buckets that we export.
+    // Values are counted against the smallest bound that their (finer grained)
+    // bucket fits within:
+    inline static const std::array<double, 15> ExportedBounds = { 0.0001, 0.00025,
+      0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 10 };
+
+  private:
+    static size_t ShardIndex() {
+      static std::atomic<size_t> next_shard{0};
+      thread_local size_t shard = next_shard.fetch_add(1,
+        std::memory_order_relaxed) % NumShards;
+      return shard;
+    }
+};
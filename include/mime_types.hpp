@@ -152,3 +152,19 @@ constexpr std::string_view _default_mime_types[] {
   "yang", "application/yang", "yin", "application/yin+xml", "yml",
   "text/yaml", "zip", "application/zip"
 };
+
+// These are the types from the above table that are worth compressing. A type
+// is compressible if it starts with any of these prefixes, or ends with any of
+// the suffixes.
+constexpr std::string_view _compressible_mime_type_prefixes[] { 
+  "text/", "application/javascript", "application/ecmascript", 
+  "application/json", "application/xml", "application/xhtml", 
+  "application/rtf", "application/postscript", "application/x-sh", 
+  "application/x-csh", "application/x-latex", "application/x-tex", 
+  "application/wasm", "image/svg+xml", "image/bmp", "image/x-icon", 
+  "message/", "model/gltf+json", "model/vrml", "model/x3d"
+};
+
+constexpr std::string_view _compressible_mime_type_suffixes[] { 
+  "+xml", "+json", "+text"
+};
@@ -17,6 +17,7 @@
 #include "exceptions.hpp"
 #include "config_parser.hpp"
 #include "utilities.hpp"
+#include "request_timing.hpp"
 
 // I suppose we could use a template here, and do without this macro...:
 // https://stackoverflow.com/questions/9065081/how-do-i-get-the-argument-types-of-a-function-pointer-in-a-variadic-template-cla
@@ -105,7 +106,10 @@ namespace Model {
   };
   typedef std::vector<Validator> Validations;
 
-  static void Log(const std::string &query) { ModelFactory::Log(query); }
+  static void Log(const std::string &query) { 
+    RequestTiming::LogQuery(query);
+    ModelFactory::Log(query); 
+  }
 
   std::tm inline NowUTC() {
     time_t t_time = time(NULL);
@@ -546,6 +550,7 @@ void Model::Instance<T>::save() {
 
   if (!isValid()) throw ModelException("Invalid Model can't be saved.");
 
+  RequestTiming::Timer timer(RequestTiming::Database);
   soci::session sql = ModelFactory::getSession("default");
 
   std::vector<std::string> columns = modelKeys();
@@ -569,7 +574,10 @@ void Model::Instance<T>::save() {
 
     // See the below note on last_insert_id. Seems like affected_rows is similarly
     // off.
-    if (long affected_rows = GetAffectedRows(update, sql); affected_rows != 1)
+    long affected_rows = GetAffectedRows(update, sql);
+    RequestTiming::QueryRows(affected_rows);
+
+    if (affected_rows != 1)
       throw ModelException("Unable to perform update, {} affected rows.", affected_rows);
 
   } else {
@@ -586,6 +594,7 @@ void Model::Instance<T>::save() {
     Model::Log(query);
 
     sql << query, soci::use(this);
+    RequestTiming::QueryRows(1);
 
     // NOTE: There appears to be a bug in the pooled session code of soci, that 
     // causes weird typecasting issues from the long long return value of 
@@ -773,6 +782,7 @@ Model::Record Model::Instance<T>::RowToRecord(soci::row &r) {
 template <class T>
 void Model::Instance<T>::Remove(std::string table_name, long long int id) {
 
+  RequestTiming::Timer timer(RequestTiming::Database);
   soci::session sql = ModelFactory::getSession("default");
   std::string query = fmt::format("delete from {table_name} where id = :id", 
     fmt::arg("table_name", table_name));
@@ -782,7 +792,10 @@ void Model::Instance<T>::Remove(std::string table_name, long long int id) {
   soci::statement delete_stmt = (sql.prepare << query, soci::use(id, "id"));
   delete_stmt.execute(true);
 
-  if (long affected_rows = GetAffectedRows(delete_stmt, sql); affected_rows != 1)
+  long affected_rows = GetAffectedRows(delete_stmt, sql);
+  RequestTiming::QueryRows(affected_rows);
+
+  if (affected_rows != 1)
     throw ModelException("Error deleting {} record with id {}. {} rows affected.", 
       table_name, id, affected_rows);
 }
@@ -794,6 +807,7 @@ std::optional<T> Model::Instance<T>::Find(long long int id){
 
 template <class T>
 std::optional<T> Model::Instance<T>::Find(std::string where, Model::Record where_values){
+  RequestTiming::Timer timer(RequestTiming::Database);
   soci::session sql = ModelFactory::getSession("default");
   soci::row r;
 
@@ -804,6 +818,7 @@ std::optional<T> Model::Instance<T>::Find(std::string where, Model::Record where
 
   Model::Log(query);
   sql << query, soci::use(&where_values), soci::into(r);
+  RequestTiming::QueryRows((sql.got_data()) ? 1 : 0);
 
   if (!sql.got_data()) return std::nullopt;
 
@@ -818,6 +833,7 @@ void Model::Instance<T>::Remove(long long int id) {
 template <class T>
 template <typename... Args> 
 std::vector<T> Model::Instance<T>::Select(std::string query, Args... args) {
+  RequestTiming::Timer timer(RequestTiming::Database);
   soci::session sql = ModelFactory::getSession("default");
   soci::statement st(sql);
   soci::row rows;
@@ -835,6 +851,7 @@ std::vector<T> Model::Instance<T>::Select(std::string query, Args... args) {
   soci::rowset_iterator<soci::row> it(st, rows);
   soci::rowset_iterator<soci::row> end;
   for (; it != end; ++it) ret.push_back(T(RowToRecord(*it), true));
+  RequestTiming::QueryRows(ret.size());
 
   return ret;
 }
@@ -842,6 +859,7 @@ std::vector<T> Model::Instance<T>::Select(std::string query, Args... args) {
 template <class T> 
 template <typename... Args> 
 unsigned long Model::Instance<T>::Count(std::string query, Args... args){
+  RequestTiming::Timer timer(RequestTiming::Database);
   soci::session sql = ModelFactory::getSession("default");
   unsigned long count;
 
@@ -855,6 +873,7 @@ unsigned long Model::Instance<T>::Count(std::string query, Args... args){
   st.prepare(query);
   st.define_and_bind();
   bool got_data = st.execute(true);
+  RequestTiming::QueryRows((got_data) ? 1 : 0);
 
   if (!got_data) throw ModelException("No data returned for count query");
 
@@ -864,6 +883,7 @@ unsigned long Model::Instance<T>::Count(std::string query, Args... args){
 template <class T> 
 template <typename... Args> 
 long long Model::Instance<T>::Execute(std::string query, Args... args){
+  RequestTiming::Timer timer(RequestTiming::Database);
   soci::session sql = ModelFactory::getSession("default");
   soci::statement st(sql);
 
@@ -877,7 +897,10 @@ long long Model::Instance<T>::Execute(std::string query, Args... args){
 
   //if (!got_data) throw ModelException("No data returned for execute query");
 
-  return st.get_affected_rows();
+  long long affected_rows = st.get_affected_rows();
+  RequestTiming::QueryRows(affected_rows);
+
+  return affected_rows;
 }
 
 template <class T>
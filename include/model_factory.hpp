@@ -1,6 +1,7 @@
 #pragma once
 #include "model.hpp"
 #include "exceptions.hpp"
+#include "metrics.hpp"
 
 // NOTE: This probably needs to be re-worked into a class or struct:
 #define PSYM_MODELS() \
@@ -59,10 +60,32 @@ struct ModelFactory {
       return (*specs)[name]; 
     }
 
+    // The pool's sessions are shared with every thread that runs a query. Take
+    // care in using them directly:
+    static std::shared_ptr<soci::connection_pool> getPool(std::string name) {
+      if (dsns->count(name) == 0)
+        throw std::runtime_error("Dsn "+name+" not found");
+
+      return (*dsns)[name];
+    }
+
+    static unsigned int getPoolSize(std::string name) {
+      if (pool_sizes.count(name) == 0)
+        throw std::runtime_error("Dsn "+name+" not found");
+
+      return pool_sizes[name];
+    }
+
     static soci::session getSession(std::string name) {
       if (dsns->count(name) == 0)
         throw std::runtime_error("Dsn "+name+" not found");
 
+      // This measures how long we waited for a free connection in the pool. The
+      // timer records on destruction, which is after the session is leased. As
+      // does the count of those waiting, come back down:
+      Metrics::ScopedTimer lease_timer(*lease_times.at(name));
+      Waiting waiting(pool_waiters.at(name));
+
       return soci::session(*(*dsns)[name]); 
     }
 
@@ -78,22 +101,42 @@ struct ModelFactory {
       std::shared_ptr<soci::connection_pool> connection_pool = \
         std::make_shared<soci::connection_pool>(threads);
 
-      for (unsigned int i = 0; i != threads; ++i) {
-        soci::session & sql = connection_pool->at(i);
-        sql.open(value);
-        if (sql.get_backend_name() == "mysql") { 
-          // Ensure that we automatically reconnect, if our connection times out
-          auto mysqlbackend = static_cast<soci::mysql_session_backend *>(sql.get_backend());
-          bool reconnect = 1;
-          mysql_options(mysqlbackend->conn_, MYSQL_OPT_RECONNECT, &reconnect);
-        }
-      }
+      for (unsigned int i = 0; i != threads; ++i) Open(connection_pool->at(i), value);
+      pool_sizes[name] = threads;
+
+      lease_times[name] = &Metrics::GetHistogram(
+        "prails_db_session_lease_seconds{dsn=\""+name+"\"}", 
+        "Time spent waiting on a connection from the database pool.");
+      // soci offers no hook for when a session is given back. So, rather than 
+      // the connections in use, we report those waiting for one. (Anything above
+      // zero, means the pool is smaller than the load)
+      auto &waiters = pool_waiters[name];
+      Metrics::SetGauge("prails_db_pool_waiters{dsn=\""+name+"\"}", 
+        "The number of threads waiting on a connection from the database pool.", 
+        [&waiters]() { return waiters.load(std::memory_order_relaxed); });
+
       dsns->insert(std::make_pair(name, connection_pool));
       // We added this, because there are times when we will have a connection 
       // handler open, and a need to parse the dsn field. 
       specs->insert(std::make_pair(name, value));
     }
 
+    // Opens a new pool for every dsn. A forked process needs to do this before it
+    // queries, since the connections it inherited are shared with its parent. 
+    // Those are abandoned, rather than closed, since closing them would tell the
+    // server that our parent quit:
+    static void Reconnect() {
+      // Deliberately leaked. Destroying these would close their sessions:
+      static auto abandoned = new std::vector<std::shared_ptr<soci::connection_pool>>();
+
+      for (auto &[name, pool] : *dsns) {
+        abandoned->push_back(pool);
+        pool = std::make_shared<soci::connection_pool>(pool_sizes[name]);
+        for (unsigned int i = 0; i != pool_sizes[name]; ++i) 
+          Open(pool->at(i), (*specs)[name]);
+      }
+    }
+
     static void Log(const std::string &message) {
       if (ModelFactory::logger != nullptr) ModelFactory::logger(message);
     }
@@ -104,6 +147,30 @@ struct ModelFactory {
     static std::shared_ptr<dsn_type> dsns;
     static std::shared_ptr<dsn_spec> specs;
     static Logger logger;
+    inline static std::map<std::string, Metrics::Histogram *> lease_times;
+    inline static std::map<std::string, unsigned int> pool_sizes;
+    inline static std::map<std::string, std::atomic<unsigned int>> pool_waiters;
+
+    class Waiting {
+      public:
+        explicit Waiting(std::atomic<unsigned int> &waiters) : waiters(waiters) {
+          waiters.fetch_add(1, std::memory_order_relaxed);
+        }
+        ~Waiting() { waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+      private:
+        std::atomic<unsigned int> &waiters;
+    };
+
+    static void Open(soci::session &sql, const std::string &value) {
+      sql.open(value);
+      if (sql.get_backend_name() == "mysql") { 
+        // Ensure that we automatically reconnect, if our connection times out
+        auto mysqlbackend = static_cast<soci::mysql_session_backend *>(sql.get_backend());
+        bool reconnect = 1;
+        mysql_options(mysqlbackend->conn_, MYSQL_OPT_RECONNECT, &reconnect);
+      }
+    }
 };
 
 template<typename T>
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "spdlog/spdlog.h"
+
+// Renders a list of urls, from a running Server, into a directory tree that can
+// be served statically. ie "/tasks" is written to "tasks/index.html", and
+// "/feed.xml" to "feed.xml". Only 200 responses are written.
+//
+// Pages are requested over several keep-alive connections at once, so that the
+// server renders them in parallel, across its threads. Compressible pages are
+// written alongside a gzip'd sidecar ("index.html.gz"), which our static
+// handler (and nginx's gzip_static) will serve to clients that accept it.
+class PageExporter {
+  public:
+    struct Result {
+      size_t exported = 0;
+      size_t failed = 0;
+    };
+
+    PageExporter(const std::string &, unsigned int, const std::string &,
+      unsigned int, std::shared_ptr<spdlog::logger> = nullptr);
+
+    Result run(const std::vector<std::string> &);
+
+    // Reads the urls from a sitemap, or from a file with one url per line:
+    static std::vector<std::string> ReadUrls(const std::string &);
+    static std::string UrlToPath(const std::string &);
+
+    // Sidecars of anything smaller than this, aren't worth the inode:
+    inline static const size_t MinGzipSize = 256;
+
+  private:
+    std::string host;
+    unsigned int port;
+    std::string output_path;
+    unsigned int connections;
+    std::shared_ptr<spdlog::logger> logger;
+
+    void write(const std::string &, const std::string &, const std::string &);
+};
@@ -5,6 +5,7 @@
 
 #include "exceptions.hpp"
 #include "utilities.hpp"
+#include "request_timing.hpp"
 
 namespace Controller {
   class PostBody {
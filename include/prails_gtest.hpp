@@ -1,5 +1,10 @@
 #include "gtest/gtest.h"
 
+#include <set>
+#include <regex>
+#include <filesystem>
+#include <unistd.h>
+
 #include <pistache/http.h>
 #include <pistache/stream.h>
 #include <pistache/router.h>
@@ -10,6 +15,7 @@
 #include "controller_factory.hpp"
 
 #include "server.hpp"
+#include "http_connection.hpp"
 
 // NOTE: This initialization must occur after models are registered
 #define PSYM_TEST_ENVIRONMENT() PSYM_TEST_ENVIRONMENT_WITH(PrailsEnvironment)
@@ -21,6 +27,140 @@
   GTEST_ENV* const prails_env = \
   static_cast<GTEST_ENV*>(::testing::AddGlobalTestEnvironment(new GTEST_ENV));
 
+// A drop-in for the httplib::Client that browser() returns. Except that its
+// connection is kept alive, between requests, and between tests. Which spares
+// every request a connect, and leaves no sockets in TIME_WAIT behind it. As
+// with httplib, a nullptr is returned if the request failed.
+class PrailsTestClient {
+  public:
+    typedef std::shared_ptr<HttpConnection::Response> ResponsePtr;
+    typedef std::map<std::string, std::string> Headers;
+
+    PrailsTestClient(const std::string &host, unsigned int port) : 
+      connection(host, port) {}
+
+    ResponsePtr Get(const std::string &path, const Headers &headers = {}) {
+      return send("GET", path, "", headers);
+    }
+    ResponsePtr Delete(const std::string &path, const Headers &headers = {}) {
+      return send("DELETE", path, "", headers);
+    }
+    ResponsePtr Options(const std::string &path, const Headers &headers = {}) {
+      return send("OPTIONS", path, "", headers);
+    }
+    ResponsePtr Post(const std::string &path, const std::string &body, 
+      const std::string &content_type, Headers headers = {}) {
+      headers["Content-Type"] = content_type;
+      return send("POST", path, body, headers);
+    }
+    ResponsePtr Put(const std::string &path, const std::string &body, 
+      const std::string &content_type, Headers headers = {}) {
+      headers["Content-Type"] = content_type;
+      return send("PUT", path, body, headers);
+    }
+
+    ResponsePtr send(const std::string &method, const std::string &path,
+      const std::string &body, const Headers &headers) {
+      try {
+        return std::make_shared<HttpConnection::Response>(
+          connection.request(method, path, body, headers));
+      } catch (const std::runtime_error &) {
+        return nullptr;
+      }
+    }
+
+  private:
+    HttpConnection connection;
+};
+
+// Returns the database to the state that it was in, once the migrations ran. 
+// sqlite databases are copied into memory with the online backup api, and
+// copied back before each test. Which, for a freshly migrated database, takes
+// microseconds. 
+//
+// Other backends have each test run in a transaction, that's rolled back once
+// the test ends. This requires that every query runs on the same connection 
+// (a db_pool_size of 1), and that the tests don't alter the schema (which 
+// commits the transaction, on mysql). Failing that, we migrate down and up.
+class PrailsDatabaseSnapshot {
+  public:
+    enum Strategy { Backup, Rollback, Migrate };
+
+    explicit PrailsDatabaseSnapshot(const std::string &dsn_name) : 
+      pool(ModelFactory::getPool(dsn_name)), 
+      pool_size(ModelFactory::getPoolSize(dsn_name)) {
+      if (pool->at(0).get_backend_name() == "sqlite3") {
+        strategy = Backup;
+        if (sqlite_api::sqlite3_open(":memory:", &snapshot) != SQLITE_OK)
+          throw std::runtime_error("Unable to open the database snapshot");
+        Copy(Connection(pool->at(0)), snapshot);
+      } else
+        strategy = (pool_size == 1) ? Rollback : Migrate;
+    }
+
+    ~PrailsDatabaseSnapshot() {
+      if (snapshot != nullptr) sqlite_api::sqlite3_close(snapshot);
+    }
+
+    PrailsDatabaseSnapshot(const PrailsDatabaseSnapshot &) = delete;
+    PrailsDatabaseSnapshot &operator=(const PrailsDatabaseSnapshot &) = delete;
+
+    Strategy strategy;
+
+    // Before each test:
+    void restore() {
+      switch (strategy) {
+        case Backup: {
+          // Every connection to a file shares the file. But, every connection
+          // to ":memory:" has a database of its own:
+          std::set<std::string> restored;
+          for (unsigned int i = 0; i < pool_size; i++) {
+            auto connection = Connection(pool->at(i));
+            std::string filename = sqlite_api::sqlite3_db_filename(connection, "main");
+            if (!filename.empty() && !restored.insert(filename).second) continue;
+            Copy(snapshot, connection);
+          }
+          break;
+        }
+        case Rollback:
+          pool->at(0).begin();
+          break;
+        case Migrate:
+          for (const auto &reg : ModelFactory::getModelNames()) {
+            ModelFactory::migrate(reg, 0);
+            ModelFactory::migrate(reg, 1);
+          }
+          break;
+      }
+    }
+
+    // After each test:
+    void release() {
+      if (strategy == Rollback) pool->at(0).rollback();
+    }
+
+  private:
+    std::shared_ptr<soci::connection_pool> pool;
+    unsigned int pool_size;
+    sqlite_api::sqlite3 *snapshot = nullptr;
+
+    static sqlite_api::sqlite3 *Connection(soci::session &sql) {
+      return static_cast<soci::sqlite3_session_backend *>(sql.get_backend())->conn_;
+    }
+
+    static void Copy(sqlite_api::sqlite3 *from, sqlite_api::sqlite3 *to) {
+      auto backup = sqlite_api::sqlite3_backup_init(to, "main", from, "main");
+      if (backup == nullptr)
+        throw std::runtime_error(std::string("Unable to copy the database: ")+
+          sqlite_api::sqlite3_errmsg(to));
+
+      sqlite_api::sqlite3_backup_step(backup, -1);
+      if (sqlite_api::sqlite3_backup_finish(backup) != SQLITE_OK)
+        throw std::runtime_error(std::string("Unable to copy the database: ")+
+          sqlite_api::sqlite3_errmsg(to));
+    }
+};
+
 class PrailsControllerTest : public ::testing::Test {
   public:
     httplib::Client browser() {
@@ -28,15 +168,68 @@ class PrailsControllerTest : public ::testing::Test {
         PrailsControllerTest::config->port());
       return httplib::Client(addr.host().c_str(), (uint16_t) addr.port());
     }
+
+    // Each thread keeps its own connection, for the life of the test program:
+    PrailsTestClient &client() {
+      thread_local std::unique_ptr<PrailsTestClient> client;
+      if (!client)
+        client = std::make_unique<PrailsTestClient>(
+          PrailsControllerTest::config->address(), 
+          PrailsControllerTest::config->port());
+      return *client;
+    }
     
     static ConfigParser *config;
 };
 
+// Tests that start from a freshly migrated database. Rather than cleaning up
+// after themselves:
+class PrailsDatabaseTest : public PrailsControllerTest {
+  public:
+    void SetUp() override {
+      if (snapshot == nullptr)
+        throw std::runtime_error("The test environment hasn't a database snapshot");
+      snapshot->restore();
+    }
+
+    void TearDown() override {
+      snapshot->release();
+    }
+
+    inline static PrailsDatabaseSnapshot *snapshot = nullptr;
+};
+
+// Every test program runs its own server, on a port of the kernel's choosing,
+// against its own database. So that test programs can run in parallel 
+// (ie, ctest -j). The chosen port is written back to the config, where the
+// tests find it.
 class PrailsEnvironment : public ::testing::Environment {
   protected:
     std::unique_ptr<Server> server;
     std::shared_ptr<ConfigParser> config;
     std::shared_ptr<spdlog::logger> logger;
+    std::string isolated_database;
+    std::unique_ptr<PrailsDatabaseSnapshot> snapshot;
+
+    // sqlite databases are files, which parallel processes would share. So,
+    // each process gets its own, in the temp directory. (":memory:" databases
+    // are already private to a process.) Other backends are used as configured:
+    std::string IsolateDsn(const std::string &dsn) {
+      std::smatch parts;
+      if (!std::regex_match(dsn, parts, 
+        std::regex("^(sqlite3://(?:.*\\s)?db=|sqlite3://)([^\\s=]+)(.*)$")))
+        return dsn;
+
+      std::string database = parts[2];
+      if (database == ":memory:") return dsn;
+
+      isolated_database = (std::filesystem::temp_directory_path() / fmt::format(
+        "prails_test.{}.{}", getpid(), 
+        std::filesystem::path(database).filename().string())).string();
+      std::filesystem::remove(isolated_database);
+
+      return std::string(parts[1])+isolated_database+std::string(parts[3]);
+    }
 
     void InitializeLogger() {
       // NOTE: Depending on how we're linked, it seems that we either share 
@@ -57,11 +250,15 @@ class PrailsEnvironment : public ::testing::Environment {
       // the constructor...
       for (const auto &reg : ModelFactory::getModelNames())
         ModelFactory::migrate(reg, 1);
+
+      snapshot = std::make_unique<PrailsDatabaseSnapshot>("default");
+      PrailsDatabaseTest::snapshot = snapshot.get();
     }
 
     void InitializeServer() {
       server = std::make_unique<Server>(*config);
       server->startThreaded();
+      config->port(server->port());
     }
 
     void DestroyServer() {
@@ -69,20 +266,29 @@ class PrailsEnvironment : public ::testing::Environment {
     }
 
     void DestroyDatabase() {
+      PrailsDatabaseTest::snapshot = nullptr;
+      snapshot.reset();
+
       for (const auto &reg : ModelFactory::getModelNames())
         ModelFactory::migrate(reg, 0);
+
+      if (!isolated_database.empty()) std::filesystem::remove(isolated_database);
     }
 
   public:
     void SetUp() override {
       config = std::make_unique<ConfigParser>(std::string(TESTS_CONFIG_FILE));
+      config->port(0);
+      config->dsn(IsolateDsn(config->dsn()));
       PrailsControllerTest::config = config.get();
 
       InitializeLogger();
-      InitializeDatabase(config->dsn(), config->threads());
+      InitializeDatabase(config->dsn(), config->db_pool_size());
       InitializeServer();
     }
 
+    unsigned int port() { return config->port(); }
+
     void TearDown() override {
       DestroyServer();
       DestroyDatabase();
@@ -0,0 +1,49 @@
+#pragma once
+#include <list>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+// A token bucket per client. Every client starts with burst tokens, and regains
+// rate tokens a second, up to burst. Each request spends a token, and requests
+// that find the bucket empty are refused.
+//
+// The buckets are spread across shards, each with its own lock, which is held
+// only for the lookup and a little arithmetic. Each shard tracks at most its
+// share of max_clients, and forgets its least recently seen client to make room
+// for a new one. (A forgotten client starts over with a full bucket.)
+class RateLimiter {
+  public:
+    static const size_t NumShards = 16;
+
+    RateLimiter(double, double, size_t);
+    RateLimiter(const RateLimiter &) = delete;
+    RateLimiter &operator=(const RateLimiter &) = delete;
+
+    bool allow(const std::string &, 
+      std::chrono::steady_clock::time_point = std::chrono::steady_clock::now());
+    size_t size();
+
+    double rate() const { return rate_; }
+    double burst() const { return burst_; }
+
+  private:
+    struct Bucket {
+      double tokens;
+      std::chrono::steady_clock::time_point updated;
+      std::list<std::string>::iterator lru;
+    };
+
+    struct alignas(64) Shard {
+      std::mutex mutex;
+      std::unordered_map<std::string, Bucket> buckets;
+      std::list<std::string> lru;
+    };
+
+    const double rate_;
+    const double burst_;
+    const size_t max_per_shard;
+    std::array<Shard, NumShards> shards;
+};
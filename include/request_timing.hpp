@@ -0,0 +1,149 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "spdlog/spdlog.h"
+
+// A breakdown of where the time went, while responding to a request. This is
+// reported to the client in a Server-Timing header, which browser devtools
+// display alongside the request.
+//
+// A RequestTiming is made current for the thread that's handling the request
+// (See RequestTiming::Scope). The model and controller layers then add to it
+// via RequestTiming::Timer, which does nothing at all, if there's no current
+// RequestTiming. Timers of the same phase that are nested (ie, a Find() that
+// calls another Find()) are only counted once.
+//
+// When capture_queries() is enabled, every statement sent to Model::Log is kept,
+// along with its duration, and the number of rows it returned or affected. This
+// is what the slow request log reports.
+class RequestTiming {
+  public:
+    enum Phase { Authorization, BodyParsing, Database, Rendering, Serialization,
+      NumPhases };
+
+    RequestTiming() : started(std::chrono::steady_clock::now()) {}
+
+    struct Query {
+      std::string statement;
+      std::chrono::steady_clock::duration duration;
+      std::optional<long long> rows;
+    };
+
+    static RequestTiming *Current() { return current; }
+
+    void capture_queries(bool is_capturing) { is_capturing_queries = is_capturing; }
+    void send_header(bool is_sending) { is_sending_header_ = is_sending; }
+    bool is_sending_header() const { return is_sending_header_; }
+    const std::vector<Query> &queries() const { return queries_; }
+
+    std::chrono::steady_clock::duration elapsed() const {
+      return std::chrono::steady_clock::now()-started;
+    }
+
+    // A query's duration runs from when it's logged, until the next query is
+    // logged, or until the Database timer that encloses it ends:
+    static void LogQuery(const std::string &statement) {
+      if (!current || !current->is_capturing_queries) return;
+      auto now = std::chrono::steady_clock::now();
+      current->finish_query(now);
+      current->queries_.push_back({statement, std::chrono::steady_clock::duration(), 
+        std::nullopt});
+      current->query_started = now;
+    }
+
+    static void QueryRows(long long rows) {
+      if (current && current->is_capturing_queries && !current->queries_.empty())
+        current->queries_.back().rows = rows;
+    }
+
+    void add(Phase phase, std::chrono::steady_clock::duration elapsed) {
+      durations[phase] += elapsed;
+      counts[phase]++;
+    }
+
+    std::chrono::steady_clock::duration duration(Phase phase) const {
+      return durations[phase];
+    }
+    unsigned int count(Phase phase) const { return counts[phase]; }
+
+    // Formats the Server-Timing header value. Durations are in milliseconds:
+    std::string header() const {
+      const std::array<const char *, NumPhases> names = {
+        "auth", "body", "db", "render", "serialize" };
+      const std::array<const char *, NumPhases> descriptions = {
+        "Authorization", "Body Parsing", "Database", "Rendering", "Serialization" };
+
+      std::string ret;
+      for (unsigned int i = 0; i < NumPhases; i++) {
+        if (counts[i] == 0) continue;
+        ret += fmt::format("{};dur={:.3f};desc=\"{}", names[i], Milliseconds(durations[i]),
+          descriptions[i]);
+        if (i == Database) ret += fmt::format(" ({} queries)", counts[i]);
+        ret += "\", ";
+      }
+
+      return ret + fmt::format("total;dur={:.3f}", Milliseconds(elapsed()));
+    }
+
+    // Makes the provided RequestTiming current, for the lifetime of the Scope:
+    class Scope {
+      public:
+        explicit Scope(RequestTiming &timing) : previous(current) { current = &timing; }
+        ~Scope() { current = previous; }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        RequestTiming *previous;
+    };
+
+    // Adds the time between its construction and destruction, to a phase of the
+    // current RequestTiming:
+    class Timer {
+      public:
+        explicit Timer(Phase phase) : phase(phase), timing(current) {
+          if (!timing) return;
+          if (timing->active[phase]++ == 0) started = std::chrono::steady_clock::now();
+        }
+        ~Timer() {
+          if (timing && (--timing->active[phase] == 0)) {
+            auto now = std::chrono::steady_clock::now();
+            timing->add(phase, now-started);
+            if (phase == Database) timing->finish_query(now);
+          }
+        }
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+      private:
+        Phase phase;
+        RequestTiming *timing;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    static double Milliseconds(std::chrono::steady_clock::duration d) {
+      return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+  private:
+    inline static thread_local RequestTiming *current = nullptr;
+
+    std::chrono::steady_clock::time_point started;
+    std::array<std::chrono::steady_clock::duration, NumPhases> durations{};
+    std::array<unsigned int, NumPhases> counts{};
+    std::array<unsigned int, NumPhases> active{};
+    bool is_capturing_queries = false;
+    bool is_sending_header_ = false;
+    std::vector<Query> queries_;
+    std::optional<std::chrono::steady_clock::time_point> query_started;
+
+    void finish_query(std::chrono::steady_clock::time_point now) {
+      if (!query_started) return;
+      queries_.back().duration = now-*query_started;
+      query_started = std::nullopt;
+    }
+};
@@ -123,6 +123,22 @@ class RestInstance : public Controller::Instance {
       return ret;
     }
 
+    // Headers that don't authorize, might otherwise get a fresh bucket on every
+    // request. And, AuthorizeAll and AuthorizeNone have but one label, which 
+    // would put every client in the same bucket:
+    optional<string> rate_limit_key(const Request &request, 
+      const string &action) override {
+      if constexpr (std::is_same_v<TAuthorizer, Controller::AuthorizeAll> || 
+        std::is_same_v<TAuthorizer, Controller::AuthorizeNone>) 
+        return nullopt;
+      else {
+        auto authorizer = fetch_authorizer<TAuthorizer>(request);
+        if (!authorizer || !authorizer->is_authorized(controller_name, action))
+          return nullopt;
+        return authorizer->authorizer_instance_label();
+      }
+    }
+
     Response options(const Request&) {
       // NOTE: There is no Authorization header sent to OPTIONS, and thus no
       // ensure_authorization() 
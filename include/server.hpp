@@ -1,6 +1,16 @@
 #pragma once
 #include "controller.hpp"
 #include "config_parser.hpp"
+#include "static_index.hpp"
+#include "static_cache.hpp"
+#include "file_watcher.hpp"
+#include "static_reader.hpp"
+#include "asset_manifest.hpp"
+#include "metrics.hpp"
+#include "cpu_set.hpp"
+
+#include <atomic>
+#include <functional>
 
 class Server {
   public:
@@ -8,21 +18,84 @@ class Server {
     void start();
     void startThreaded();
     void shutdown();
+    unsigned int port();
     static std::optional<std::string> ExtToMime(const std::string &);
+    static std::optional<std::string> RequestHeader(
+      const Pistache::Rest::Request &, const std::string &);
+    static bool IsCompressible(const Pistache::Http::Mime::MediaType &);
+    static bool AcceptsGzip(const std::optional<std::string> &);
+    static std::optional<std::vector<std::pair<size_t, size_t>>> ParseRanges(
+      const std::string &, size_t);
+
+    inline static const size_t MaxRanges = 16;
+    // Ranges are handed to pistache in slices of this size:
+    inline static const size_t StreamSliceLength = 64 * 1024;
   private:
+    class ReactorPinningHandler : public Pistache::Http::Handler {
+      public:
+        HTTP_PROTOTYPE(ReactorPinningHandler)
+        ReactorPinningHandler(Pistache::Rest::Router &, const CpuSet &,
+          std::shared_ptr<spdlog::logger>);
+        void onRequest(const Pistache::Http::Request &, 
+          Pistache::Http::ResponseWriter) override;
+      private:
+        Pistache::Rest::Router *router;
+        CpuSet cpus;
+        std::shared_ptr<spdlog::logger> logger;
+        // Shared between the clones, which pistache makes for each reactor:
+        std::shared_ptr<std::atomic<size_t>> next_cpu;
+    };
+
     size_t threads;
     size_t max_request_size;
+    bool is_static_gzip;
     std::shared_ptr<spdlog::logger> logger;
     std::string html_error500;
     std::string html_error404;
     std::string path_static;
     std::string path_views;
+    std::string path_metrics;
     std::shared_ptr<Pistache::Http::Endpoint> http_endpoint;
     Pistache::Rest::Router router;
+    StaticIndex static_index;
+    StaticCache static_cache;
+    std::unique_ptr<FileWatcher> static_watcher;
+    std::unique_ptr<FileWatcher> views_watcher;
+    std::unique_ptr<StaticReader> static_reader;
+    std::shared_ptr<AssetManifest> asset_manifest;
+    std::shared_ptr<WorkerPool> workers;
+    std::shared_ptr<AdmissionControl> admission;
+    std::shared_ptr<FragmentCache> fragments;
+    std::shared_ptr<IncludeStore> includes;
+    Metrics::Counter *static_hits;
+    Metrics::Counter *static_misses;
+    Metrics::Counter *static_not_found;
+    CpuSet reactor_cpus;
+    CpuSet background_cpus;
+    bool is_pinning_reactors;
 
     std::map<std::string, std::shared_ptr<Controller::Instance>> controllers;
 
     void setupRoutes();
+    void setupStatic();
+    void setupViews(const std::string &);
+    std::shared_ptr<Pistache::Http::Handler> handler();
+    void inBackground(const std::function<void()> &);
+    Pistache::Http::Mime::MediaType PathToMediaType(const std::string &);
     void doNotFound(const Pistache::Rest::Request&, Pistache::Http::ResponseWriter);
+    void doMetrics(const Pistache::Rest::Request&, Pistache::Http::ResponseWriter);
+    void readStatic(const Pistache::Rest::Request&, Pistache::Http::ResponseWriter,
+      const std::string &, StaticIndex::EntryPtr, const std::optional<std::string> &,
+      bool);
+    void sendStatic(const Pistache::Rest::Request&, Pistache::Http::ResponseWriter,
+      StaticCache::EntryPtr);
+    void sendRanges(Pistache::Http::ResponseWriter, StaticCache::EntryPtr,
+      const std::vector<std::pair<size_t, size_t>> &, bool);
+    void sendHead(Pistache::Http::ResponseWriter, Pistache::Http::Code, size_t,
+      const std::optional<Pistache::Http::Mime::MediaType> & = std::nullopt);
+    static std::string ResponseHead(Pistache::Http::ResponseWriter &, 
+      Pistache::Http::Code, size_t, 
+      const std::optional<Pistache::Http::Mime::MediaType> & = std::nullopt);
+    static size_t FileSize(const std::string &);
 };
 
@@ -0,0 +1,88 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <optional>
+#include <unordered_map>
+
+#include <pistache/http.h>
+
+// A size-bounded, least-recently-used cache of the static files that the Server
+// has already resolved. Entries are keyed by request resource, and hold
+// everything needed to answer a request without touching the filesystem. Files
+// that are larger than max_file_bytes are cached without their content, which
+// still lets us answer conditional requests from memory.
+//
+// Entries may also carry a gzip'd representation of the file. Either from a
+// precompressed "foo.js.gz" sidecar, or, by compressing the content once, when
+// it's loaded. (Entries that won't fit in the cache are served uncompressed,
+// rather than compressed on every request)
+class StaticCache {
+  public:
+    struct Entry {
+      std::string resource;
+      std::string local_path;
+      std::string content;
+      bool is_resident;
+      size_t size;
+      time_t mtime;
+      std::string etag;
+      std::string last_modified;
+      Pistache::Http::Mime::MediaType mime_type;
+      std::string gzip_path;
+      std::string gzip_content;
+      std::string gzip_etag;
+
+      bool has_gzip() const { return !gzip_path.empty() || !gzip_content.empty(); }
+      bool is_not_modified(const std::optional<std::string> &,
+        const std::optional<std::string> &) const;
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    // A file that's been stat()'d, but not yet read. This lets the content be
+    // read somewhere other than the calling thread (See StaticReader).
+    struct Pending {
+      std::shared_ptr<Entry> entry;
+      std::optional<std::string> gzip_path;
+      bool is_compressible;
+      unsigned long generation;
+    };
+
+    StaticCache(size_t max_bytes, size_t max_file_bytes) :
+      max_bytes(max_bytes), max_file_bytes(max_file_bytes) {}
+
+    EntryPtr find(const std::string &);
+    EntryPtr load(const std::string &, const std::string &,
+      const Pistache::Http::Mime::MediaType &, 
+      const std::optional<std::string> & = std::nullopt, bool = false);
+    std::optional<Pending> prepare(const std::string &, const std::string &,
+      const Pistache::Http::Mime::MediaType &, 
+      const std::optional<std::string> & = std::nullopt, bool = false);
+    EntryPtr complete(const Pending &, std::string = std::string(),
+      std::optional<std::string> = std::nullopt);
+    void invalidate(const std::string &);
+    void clear();
+    void disable();
+
+    size_t size();
+    size_t bytes();
+    bool is_enabled();
+
+    static std::optional<std::string> Gzip(const std::string &);
+
+  private:
+    typedef std::list<EntryPtr> LruList;
+
+    size_t max_bytes;
+    size_t max_file_bytes;
+    size_t bytes_used = 0;
+    unsigned long generation = 0;
+    std::mutex mutex;
+    LruList lru;
+    std::unordered_map<std::string, LruList::iterator> entries;
+
+    static size_t EntryBytes(const Entry &);
+    bool is_retainable(const Entry &, unsigned long);
+    void erase(LruList::iterator);
+};
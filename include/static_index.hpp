@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <optional>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <pistache/http.h>
+
+// An index of every file that's servable from the static resource path, keyed
+// by request resource (ie "/js/app.js"). Files are vetted once, when they're
+// indexed, so that a request is only ever a single hash lookup. Symlinks, and
+// names outside of our sane character set are never indexed.
+class StaticIndex {
+  public:
+    struct Entry {
+      std::string local_path;
+      Pistache::Http::Mime::MediaType mime_type;
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+    typedef std::function<Pistache::Http::Mime::MediaType(const std::string &)>
+      MimeResolver;
+
+    StaticIndex(const std::string &, MimeResolver);
+
+    EntryPtr find(const std::string &);
+    void rebuild();
+    void update(const std::string &);
+    size_t size();
+
+  private:
+    std::string root;
+    MimeResolver mime_resolver;
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, EntryPtr> entries;
+
+    std::optional<std::string> resource_for(const std::string &);
+    void index_path(const std::string &);
+    void index_file(const std::string &);
+    void erase_path(const std::string &);
+};
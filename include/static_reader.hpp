@@ -0,0 +1,28 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <optional>
+#include <functional>
+
+// Reads static files off of the pistache reactor threads, so that a slow (or
+// cold) disk only delays the requests that are waiting on it. The callback is
+// invoked with the file's content, or with nullopt if the file couldn't be read.
+// Typically, that's from a thread owned by the reader, though failures to open
+// (or to submit) a read may be reported immediately, from the calling thread.
+//
+// Two backends are available: "io_uring", which submits reads to the kernel and
+// completes them from a single completion thread, and "threads", a small pool of
+// threads performing blocking reads. The io_uring backend is only available when
+// prails was built against liburing, and the kernel supports it. Otherwise,
+// Create() falls back to the thread pool.
+class StaticReader {
+  public:
+    typedef std::function<void(std::optional<std::string>)> Callback;
+
+    virtual ~StaticReader() {}
+    virtual void read(const std::string &, Callback) = 0;
+    virtual std::string name() = 0;
+
+    static std::unique_ptr<StaticReader> Create(const std::string &, unsigned int);
+    static bool IsUringAvailable();
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <map>
+#include <set>
+#include <string>
+#include <memory>
+#include <iosfwd>
+#include <optional>
+#include <functional>
+#include <string_view>
+#include <shared_mutex>
+
+#include <nlohmann/json.hpp>
+
+namespace inja { class Environment; struct Template; }
+
+// Parsed views, so that a request needn't re-read, and re-parse, its view and
+// layout from disk. Templates are parsed once, on their first render, and are
+// then rendered concurrently, by every thread.
+//
+// When revalidating (development), the mtimes of each template, and of the
+// templates that it includes (however deeply), are checked on every render. If any changed,
+// everything is re-parsed, since inja offers no way to forget a single include.
+// Otherwise (production), we don't touch the disk again, once a template is
+// cached.
+//
+// A loader may supply templates from memory (ie, EmbeddedViews). Those that it
+// has are never read from disk, and are never stale.
+//
+// Layouts are rendered in a single pass, into a single string, with the view
+// rendered in place of the layout's {{ content }}.
+class TemplateCache {
+  public:
+    typedef std::function<void(inja::Environment &)> Setup;
+    typedef std::function<std::optional<std::string_view>(const std::string &)> 
+      Loader;
+
+    // The setup is run on every environment that we create, to add callbacks:
+    explicit TemplateCache(bool, Setup = nullptr, Loader = nullptr);
+    ~TemplateCache();
+    TemplateCache(const TemplateCache &) = delete;
+    TemplateCache &operator=(const TemplateCache &) = delete;
+
+    std::string render(const std::string &, const nlohmann::json &);
+
+    // Renders the view (the second path) inside the layout (the first). Layouts 
+    // that can't be streamed, get the view's output as "content", in the data:
+    std::string render(const std::string &, const std::string &, 
+      nlohmann::json &);
+    size_t size();
+    void clear();
+
+    // The path of the template being rendered on this thread. Callbacks use this
+    // to find files that are relative to it:
+    static const std::string &RenderingPath() { return rendering_path; }
+
+    // The cache that's rendering on this thread, if any. Callbacks may render 
+    // templates of this cache, from inside a render:
+    static TemplateCache *Rendering() { return rendering_cache; }
+
+  private:
+    struct Entry;
+    struct Generation;
+
+    bool is_revalidating;
+    Setup setup;
+    Loader loader;
+    std::shared_mutex mutex;
+    std::shared_ptr<Generation> generation;
+
+    inline static thread_local std::string rendering_path;
+    inline static thread_local TemplateCache *rendering_cache = nullptr;
+
+    std::shared_ptr<Generation> create_generation();
+    void render_to(std::ostream &, Generation &, const std::string &, 
+      const inja::Template &, const nlohmann::json &);
+    const Entry *find(Generation &, const std::string &, bool);
+    void ensure(const std::string &, bool);
+    void parse_layout(Entry &, const std::string &, const std::string &);
+    inja::Template parse_text(const std::string &, std::string_view);
+    void add_includes(const inja::Template &, std::set<std::string> &);
+    bool is_referencing(const inja::Template &, const std::string &);
+    bool is_stale(const Entry &);
+};
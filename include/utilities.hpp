@@ -2,6 +2,8 @@
 #include <vector> 
 #include <regex> 
 #include <string_view>
+#include <optional>
+#include <ctime>
 
 namespace prails::utilities {
   bool path_is_readable(const std::string &);
@@ -16,5 +18,7 @@ namespace prails::utilities {
   std::string replace_all(const std::string &, const std::string &,const std::string &);
   std::string tm_to_iso8601(std::tm);
   std::tm iso8601_to_tm(const std::string &);
+  std::string time_to_http_date(time_t);
+  std::optional<time_t> http_date_to_time(const std::string &);
   std::pair<int,std::string> capture_system(const std::string &);
 }
@@ -0,0 +1,57 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include "cpu_set.hpp"
+
+// Runs controller actions off of the pistache reactor threads, so that an action
+// which is waiting on the database only holds up a worker, and not every other
+// connection on its reactor.
+//
+// Every worker has its own queue. Tasks submitted from outside the pool are
+// spread across the queues, round-robin. Tasks submitted by a worker go onto
+// that worker's own queue. A worker whose queue is empty steals from the back of
+// the others, so that one slow action doesn't strand the tasks queued behind it.
+class WorkerPool {
+  public:
+    typedef std::function<void()> Task;
+
+    explicit WorkerPool(unsigned int, const CpuSet & = CpuSet());
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void submit(Task);
+    void shutdown();
+    size_t size() const { return queues.size(); }
+    size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_queue{0};
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    bool is_stopping = false;
+    CpuSet cpus;
+
+    // The worker (if any) that the current thread is, so that submit() can queue
+    // onto its own queue:
+    inline static thread_local WorkerPool *current_pool = nullptr;
+    inline static thread_local size_t current_worker = 0;
+
+    void work(size_t);
+    bool pop(size_t, Task &);
+};
@@ -0,0 +1,102 @@
+#include <vector>
+#include <stdexcept>
+
+#include "admission_control.hpp"
+
+using namespace std;
+
+AdmissionControl::AdmissionControl(unsigned int max_in_flight, size_t max_waiting,
+  chrono::milliseconds max_wait) : max_in_flight_(max_in_flight), 
+  max_waiting(max_waiting), max_wait(max_wait) {
+  if (max_in_flight == 0) 
+    throw invalid_argument("Admission control requires a limit above zero");
+
+  if (max_waiting > 0) dispatcher = thread(&AdmissionControl::dispatch, this);
+}
+
+// Waiters that are still queued are dropped. By now, there's no one to respond
+// to them:
+AdmissionControl::~AdmissionControl() {
+  {
+    lock_guard<std::mutex> guard(mutex);
+    is_stopping = true;
+  }
+  changed.notify_all();
+  if (dispatcher.joinable()) dispatcher.join();
+}
+
+bool AdmissionControl::try_acquire() {
+  unsigned int current = in_flight_.load(memory_order_relaxed);
+  while (current < max_in_flight_)
+    if (in_flight_.compare_exchange_weak(current, current+1, memory_order_acq_rel))
+      return true;
+  return false;
+}
+
+void AdmissionControl::acquire(Continuation continuation) {
+  if (try_acquire()) return continuation(true);
+  if (max_waiting == 0) return continuation(false);
+
+  bool is_full;
+  {
+    lock_guard<std::mutex> guard(mutex);
+    is_full = (waiters.size() >= max_waiting);
+    if (!is_full) {
+      waiting_.fetch_add(1);
+      waiters.push_back({chrono::steady_clock::now()+max_wait, std::move(continuation)});
+    }
+  }
+  if (is_full) return continuation(false);
+
+  // A slot may have been released between our try_acquire(), and our joining the
+  // queue. The releaser wouldn't have seen us waiting, so the dispatcher checks:
+  changed.notify_one();
+}
+
+void AdmissionControl::release() {
+  in_flight_.fetch_sub(1);
+  if (waiting_.load() == 0) return;
+
+  // Taking the lock ensures that the dispatcher is either yet to try_acquire(), 
+  // or is already waiting on us. Otherwise, we could notify it in between:
+  { lock_guard<std::mutex> guard(mutex); }
+  changed.notify_one();
+}
+
+// Admits as many waiters as there's room for, and sheds those that have waited
+// too long. Continuations are called outside of the lock, since an admitted 
+// request may well finish (and release) before its continuation returns. Since 
+// waiters all wait for the same max_wait, the oldest has the nearest deadline:
+void AdmissionControl::dispatch() {
+  unique_lock<std::mutex> lock(mutex);
+
+  while (!is_stopping) {
+    vector<Continuation> admitted, shed;
+    auto now = chrono::steady_clock::now();
+
+    while (!waiters.empty()) {
+      if (waiters.front().deadline <= now)
+        shed.push_back(std::move(waiters.front().continuation));
+      else if (try_acquire())
+        admitted.push_back(std::move(waiters.front().continuation));
+      else
+        break;
+
+      waiters.pop_front();
+      waiting_.fetch_sub(1);
+    }
+
+    if (admitted.empty() && shed.empty()) {
+      if (waiters.empty()) 
+        changed.wait(lock);
+      else
+        changed.wait_until(lock, waiters.front().deadline);
+      continue;
+    }
+
+    lock.unlock();
+    for (auto &continuation : shed) continuation(false);
+    for (auto &continuation : admitted) continuation(true);
+    lock.lock();
+  }
+}
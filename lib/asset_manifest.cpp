@@ -0,0 +1,142 @@
+#include <fstream>
+#include <filesystem>
+#include <sys/stat.h>
+
+#include <nlohmann/json.hpp>
+
+#include "asset_manifest.hpp"
+#include "utilities.hpp"
+#include "picosha2.h"
+
+using namespace std;
+using namespace prails::utilities;
+
+AssetManifest::AssetManifest(const string &root) : root(root) {}
+
+void AssetManifest::build() {
+  map<string, Asset> built;
+
+  for (const auto &entry : filesystem::recursive_directory_iterator(root)) {
+    if (entry.is_symlink() || !entry.is_regular_file()) continue;
+
+    string local_path = entry.path().string();
+
+    // Precompressed sidecars are served alongside the file that they compress:
+    if (entry.path().extension() == ".gz") continue;
+
+    struct stat st;
+    if (stat(local_path.c_str(), &st) != 0) continue;
+
+    string content = read_file(local_path);
+    string resource = local_path.substr(root.size());
+    string digest = picosha2::hash256_hex_string(content.begin(), content.end());
+
+    built[resource] = Asset({Fingerprint(resource, digest), digest,
+      static_cast<size_t>(st.st_size), st.st_mtim.tv_sec});
+  }
+
+  unique_lock<shared_mutex> guard(mutex);
+  assets.clear();
+  resources.clear();
+  for (const auto &[resource, asset] : built) insert(resource, asset);
+}
+
+void AssetManifest::load(const string &manifest_path) {
+  ifstream in(manifest_path);
+  if (!in.is_open()) throw runtime_error("Unable to read "+manifest_path);
+
+  auto manifest = nlohmann::json::parse(in);
+
+  map<string, Asset> loaded;
+
+  for (const auto &[resource, asset] : manifest.items()) {
+    string local_path = root+resource;
+
+    struct stat st;
+    if ((stat(local_path.c_str(), &st) != 0) ||
+      (static_cast<size_t>(st.st_size) != asset["size"].get<size_t>()))
+      continue;
+
+    // A matching size and mtime doesn't mean that the content is unchanged. (A
+    // copy, or an edit within the same second, can leave both as they were) Since
+    // clients will cache these forever, we only trust the digest:
+    string content = read_file(local_path);
+    string digest = picosha2::hash256_hex_string(content.begin(), content.end());
+    if (digest != asset["digest"].get<string>()) continue;
+
+    loaded[resource] = Asset({Fingerprint(resource, digest), digest, content.size(),
+      st.st_mtim.tv_sec});
+  }
+
+  unique_lock<shared_mutex> guard(mutex);
+  assets.clear();
+  resources.clear();
+  for (const auto &[resource, asset] : loaded) insert(resource, asset);
+}
+
+void AssetManifest::save(const string &manifest_path) {
+  auto manifest = nlohmann::json::object();
+  {
+    shared_lock<shared_mutex> guard(mutex);
+    for (const auto &[resource, asset] : assets)
+      manifest[resource] = { {"fingerprinted", asset.fingerprinted},
+        {"digest", asset.digest}, {"size", asset.size}, {"mtime", asset.mtime} };
+  }
+
+  ofstream out(manifest_path);
+  if (!out.is_open()) throw runtime_error("Unable to write "+manifest_path);
+  out << manifest.dump(2);
+}
+
+// The provided path may be a file, or a directory that contains files:
+void AssetManifest::invalidate(const string &local_path) {
+  if (!starts_with(local_path, root)) return;
+  string resource = local_path.substr(root.size());
+
+  unique_lock<shared_mutex> guard(mutex);
+  for (auto it = assets.begin(); it != assets.end(); ) {
+    if (resource.empty() || (it->first == resource) ||
+      starts_with(it->first, resource+"/")) {
+      resources.erase(it->second.fingerprinted);
+      it = assets.erase(it);
+    } else
+      it++;
+  }
+}
+
+optional<string> AssetManifest::path_for(const string &resource) {
+  shared_lock<shared_mutex> guard(mutex);
+  auto it = assets.find(resource);
+  return (it == assets.end()) ? nullopt : make_optional(it->second.fingerprinted);
+}
+
+optional<string> AssetManifest::resource_for(const string &fingerprinted) {
+  shared_lock<shared_mutex> guard(mutex);
+  auto it = resources.find(fingerprinted);
+  return (it == resources.end()) ? nullopt : make_optional(it->second);
+}
+
+size_t AssetManifest::size() {
+  shared_lock<shared_mutex> guard(mutex);
+  return assets.size();
+}
+
+// The digest is inserted before the extension, so that the mime type of the
+// fingerprinted resource is unchanged. ie "/js/app.js" becomes "/js/app.3f9c1a2b4d.js"
+string AssetManifest::Fingerprint(const string &resource, const string &digest) {
+  string fingerprint = digest.substr(0, FingerprintLength);
+
+  auto slash = resource.rfind('/');
+  auto dot = resource.rfind('.');
+
+  // Dot files (ie "/.htaccess") and files without an extension, get a suffix:
+  if ((dot == string::npos) || (slash == string::npos) || (dot <= slash+1))
+    return resource+"."+fingerprint;
+
+  return resource.substr(0, dot)+"."+fingerprint+resource.substr(dot);
+}
+
+void AssetManifest::insert(const string &resource, const Asset &asset) {
+  assets[resource] = asset;
+  resources[asset.fingerprinted] = resource;
+}
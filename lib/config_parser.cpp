@@ -1,5 +1,6 @@
 #include "config_parser.hpp"
 #include "utilities.hpp"
+#include "cpu_set.hpp"
 
 #include "spdlog/async.h"
 
@@ -10,6 +11,7 @@
 
 #include <filesystem>
 #include <regex>
+#include <algorithm>
 
 using namespace std;
 using namespace prails::utilities;
@@ -18,10 +20,28 @@ ConfigParser::ConfigParser() {
   port_ = 8080;
   threads_ = 2;
   max_request_size_ = 4096; // pistache's DefaultMaxRequestSize
+  static_cache_size_ = 32 * 1024 * 1024;
+  static_cache_max_file_size_ = 1024 * 1024;
+  fragment_cache_size_ = 16 * 1024 * 1024;
+  static_gzip_ = false;
+  static_reader_ = "blocking";
+  static_reader_threads_ = 4;
+  workers_ = 1;
+  worker_threads_ = 0;
+  db_pool_size_ = 0;
+  max_in_flight_ = 0;
+  admission_queue_size_ = 0;
+  admission_queue_timeout_ms_ = 1000;
+  retry_after_ = 1;
+  rate_limit_max_clients_ = 65536;
+  pin_reactors_ = false;
+  server_timing_ = false;
+  slow_request_threshold_ms_ = 0;
   address_ = "0.0.0.0";
   base_path = ".";
   static_resource_path_ = "public";
   views_path_ = "views";
+  view_cache_ = "development";
   config_path_ = "config";
   log_level_ = "info";
 
@@ -42,6 +62,49 @@ ConfigParser::ConfigParser(string config_file_path) : ConfigParser() {
     if (has_value("threads")) threads_ = get<unsigned int>("threads");
     if (has_value("max_request_size"))
       max_request_size_ = get<unsigned int>("max_request_size");
+    if (has_value("static_cache_size"))
+      static_cache_size_ = get<unsigned int>("static_cache_size");
+    if (has_value("fragment_cache_size"))
+      fragment_cache_size_ = get<unsigned int>("fragment_cache_size");
+    if (has_value("static_cache_max_file_size"))
+      static_cache_max_file_size_ = get<unsigned int>("static_cache_max_file_size");
+    if (has_value("static_gzip")) static_gzip_ = get<bool>("static_gzip");
+    if (has_value("static_reader")) static_reader_ = get<string>("static_reader");
+    if (has_value("static_reader_threads"))
+      static_reader_threads_ = get<unsigned int>("static_reader_threads");
+    if (has_value("workers")) workers_ = get<unsigned int>("workers");
+    if (has_value("worker_threads")) 
+      worker_threads_ = get<unsigned int>("worker_threads");
+    if (has_value("db_pool_size")) db_pool_size_ = get<unsigned int>("db_pool_size");
+    if (has_value("max_in_flight")) max_in_flight_ = get<unsigned int>("max_in_flight");
+    if (has_value("action_max_in_flight"))
+      action_max_in_flight_ = get<map<string, unsigned int>>("action_max_in_flight");
+    if (has_value("admission_queue_size")) 
+      admission_queue_size_ = get<unsigned int>("admission_queue_size");
+    if (has_value("admission_queue_timeout_ms")) 
+      admission_queue_timeout_ms_ = get<unsigned int>("admission_queue_timeout_ms");
+    if (has_value("retry_after")) retry_after_ = get<unsigned int>("retry_after");
+    if (has_value("rate_limit_max_clients")) 
+      rate_limit_max_clients_ = get<unsigned int>("rate_limit_max_clients");
+
+    if (has_value("reactor_cpus")) reactor_cpus_ = get<string>("reactor_cpus");
+    if (has_value("pin_reactors")) pin_reactors_ = get<bool>("pin_reactors");
+    if (has_value("worker_cpus")) worker_cpus_ = get<string>("worker_cpus");
+    if (has_value("background_cpus")) background_cpus_ = get<string>("background_cpus");
+
+    // ie: "TasksController#create": { rate: 5, burst: 10, key: "authorizer" }
+    if (has_value("rate_limits"))
+      for (const auto &route : yaml["rate_limits"]) {
+        auto limit = route.second;
+        string key = (limit["key"]) ? limit["key"].as<string>() : "address";
+        if (!regex_match(key, regex("^(?:address|authorizer)$")))
+          throw invalid_argument("Invalid rate_limits key \""+key+"\"");
+
+        double rate = limit["rate"].as<double>();
+        rate_limits_[route.first.as<string>()] = RateLimit({ rate, 
+          (limit["burst"]) ? limit["burst"].as<double>() : max(rate, 1.0),
+          (key == "authorizer") });
+      }
     if (has_value("spdlog_queue_size")) 
       spdlog_queue_size(get<unsigned int>("spdlog_queue_size"));
     if (has_value("address")) address_ = get<string>("address");
@@ -49,15 +112,62 @@ ConfigParser::ConfigParser(string config_file_path) : ConfigParser() {
       static_resource_path_ = get<string>("static_resource_path");
     if (has_value("views_path")) views_path_ = get<string>("views_path");
     if (has_value("config_path")) config_path_ = get<string>("config_path");
+    if (has_value("asset_manifest")) asset_manifest_ = get<string>("asset_manifest");
     if (has_value("log_directory")) log_directory_ = get<string>("log_directory");
     if (has_value("log_level")) log_level_ = get<string>("log_level");
     if (has_value("dsn")) dsn_ = get<string>("dsn");
+    if (has_value("view_cache")) view_cache_ = get<string>("view_cache");
     if (has_value("cors_allow")) cors_allow_ = get<string>("cors_allow");
+    if (has_value("metrics_path")) metrics_path_ = get<string>("metrics_path");
+    if (has_value("server_timing")) server_timing_ = get<bool>("server_timing");
+    if (has_value("slow_request_threshold_ms"))
+      slow_request_threshold_ms_ = get<unsigned int>("slow_request_threshold_ms");
   }
 
   if(!regex_match(log_level(), regex("^(?:critical|err|warn|info|debug|trace|off)$")))
     throw invalid_argument("Invalid Log Level specified in config");
 
+  if(!regex_match(static_reader(), regex("^(?:blocking|threads|io_uring)$")))
+    throw invalid_argument("Invalid static_reader specified in config");
+
+  // In production, views are never re-read once they've been parsed:
+  if(!regex_match(view_cache(), regex("^(?:production|development)$")))
+    throw invalid_argument("Invalid view_cache specified in config");
+
+  // Queued requests are admitted by the admission control's dispatcher thread, 
+  // which only decides. Running them is left to the worker pool:
+  if ((admission_queue_size_ > 0) && (worker_threads_ == 0))
+    throw invalid_argument("admission_queue_size requires worker_threads");
+
+  // These are cpu lists, as taskset accepts them. ie "0-3,8":
+  for (const auto &cpus : {reactor_cpus_, worker_cpus_, background_cpus_})
+    if (!cpus.empty() && 
+      !regex_match(cpus, regex("^\\d+(?:-\\d+)?(?:,\\d+(?:-\\d+)?)*$")))
+      throw invalid_argument("Invalid cpu list \""+cpus+"\" specified in config");
+
+  // The log writer was started before we knew where it belonged. So, we restart 
+  // it, now that we do. (No loggers have been set up yet, to lose it):
+  if (!background_cpus_.empty()) spdlog_queue_size(spdlog_queue_size_);
+
+  if (pin_reactors_ && reactor_cpus_.empty())
+    throw invalid_argument("pin_reactors requires a reactor_cpus list");
+
+  if (workers_ == 0) throw invalid_argument("At least one worker is required");
+
+  // A port of 0 has the kernel choose one. Which it would, for every worker:
+  if ((port_ == 0) && (workers_ > 1))
+    throw invalid_argument("Preforked workers require a port to be specified");
+
+  for (const auto &[route, limit] : action_max_in_flight_)
+    if (!regex_match(route, regex("^[^#]+#[^#]+$")))
+      throw invalid_argument("Invalid action_max_in_flight route \""+route+"\". "
+        "Expected Controller#action");
+
+  for (const auto &[route, limit] : rate_limits_)
+    if (!regex_match(route, regex("^[^#]+#[^#]+$")))
+      throw invalid_argument("Invalid rate_limits route \""+route+"\". "
+        "Expected Controller#action, or Controller#*");
+
   if (static_resource_path_.empty())
     throw invalid_argument("Unreadable or missing static_resource_path.");
 
@@ -105,24 +215,79 @@ unsigned int ConfigParser::threads() { return threads_; }
 unsigned int ConfigParser::max_request_size() { 
   return max_request_size_;
 }
+unsigned int ConfigParser::static_cache_size() { return static_cache_size_; }
+unsigned int ConfigParser::fragment_cache_size() { return fragment_cache_size_; }
+unsigned int ConfigParser::static_cache_max_file_size() { 
+  return static_cache_max_file_size_;
+}
+bool ConfigParser::static_gzip() { return static_gzip_; }
+string ConfigParser::static_reader() { return static_reader_; }
+unsigned int ConfigParser::static_reader_threads() { return static_reader_threads_; }
+unsigned int ConfigParser::workers() { return workers_; }
+unsigned int ConfigParser::worker_threads() { return worker_threads_; }
+unsigned int ConfigParser::max_in_flight() { return max_in_flight_; }
+map<string, unsigned int> ConfigParser::action_max_in_flight() { 
+  return action_max_in_flight_; 
+}
+unsigned int ConfigParser::admission_queue_size() { return admission_queue_size_; }
+unsigned int ConfigParser::admission_queue_timeout_ms() { 
+  return admission_queue_timeout_ms_; 
+}
+unsigned int ConfigParser::retry_after() { return retry_after_; }
+map<string, ConfigParser::RateLimit> ConfigParser::rate_limits() { 
+  return rate_limits_; 
+}
+unsigned int ConfigParser::rate_limit_max_clients() { 
+  return rate_limit_max_clients_; 
+}
+string ConfigParser::reactor_cpus() { return reactor_cpus_; }
+bool ConfigParser::pin_reactors() { return pin_reactors_; }
+string ConfigParser::worker_cpus() { return worker_cpus_; }
+string ConfigParser::background_cpus() { return background_cpus_; }
+
+// Unless specified, every thread that runs actions gets a database session:
+unsigned int ConfigParser::db_pool_size() { 
+  if (db_pool_size_ > 0) return db_pool_size_;
+  return (worker_threads_ > 0) ? worker_threads_ : threads_;
+}
 unsigned int ConfigParser::spdlog_queue_size() { return spdlog_queue_size_; }
 string ConfigParser::address() { return address_; }
 string ConfigParser::static_resource_path() { return expand_path(static_resource_path_); }
 string ConfigParser::views_path() { return expand_path(views_path_); }
 string ConfigParser::config_path() { return expand_path(config_path_); }
+string ConfigParser::asset_manifest() { 
+  return (asset_manifest_.empty()) ? config_path()+"/assets.json" : 
+    expand_path(asset_manifest_); 
+}
 string ConfigParser::log_directory() { 
   return (log_directory_.empty()) ? string() : expand_path(log_directory_); 
 }
 bool ConfigParser::is_logging_to_console() { return is_logging_to_console_; }
 string ConfigParser::log_level() { return log_level_; }
 string ConfigParser::dsn() { return dsn_; }
+string ConfigParser::view_cache() { return view_cache_; }
+void ConfigParser::dsn(const string &d) { dsn_ = d; }
 string ConfigParser::cors_allow() { return cors_allow_; }
+string ConfigParser::metrics_path() { return metrics_path_; }
+bool ConfigParser::server_timing() { return server_timing_; }
+unsigned int ConfigParser::slow_request_threshold_ms() { 
+  return slow_request_threshold_ms_; 
+}
 
 void ConfigParser::log_directory(const string &d) { log_directory_ = d; }
 void ConfigParser::threads(unsigned int t) { threads_ = t; }
+void ConfigParser::port(unsigned int p) { port_ = p; }
 void ConfigParser::spdlog_queue_size(unsigned int q) { 
   spdlog_queue_size_ = q;
-  spdlog::init_thread_pool(spdlog_queue_size_, 1);
+
+  // The log writer is a background thread, and pins itself as it starts. (If 
+  // the cpus are unusable, the server will say so, when it pins its own):
+  spdlog::init_thread_pool(spdlog_queue_size_, 1, [cpus = background_cpus_]() {
+    if (cpus.empty()) return;
+    try {
+      CpuSet(cpus).pin();
+    } catch (const exception &) { }
+  });
 }
 
 void ConfigParser::log_level(const string &s) { log_level_ = s; }
@@ -1,6 +1,9 @@
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include "controller.hpp"
 #include "inja.hpp"
+#include "embedded_views.hpp"
 
 using namespace std;
 using namespace nlohmann;
@@ -8,6 +11,20 @@ using namespace Pistache;
 using namespace Pistache::Http;
 using namespace prails::utilities;
 
+// Views use {{ asset_path("/js/app.js") }} to link to the fingerprinted version of
+// an asset. Assets that aren't in the manifest, are linked as is:
+static void AddAssetCallbacks(inja::Environment &env) {
+  env.add_callback("asset_path", 1, [](inja::Arguments& args) {
+    auto resource = args.at(0)->get<string>();
+    if (!starts_with(resource, "/")) resource = "/"+resource;
+
+    auto manifest = Controller::GetAssetManifest();
+    auto fingerprinted = (manifest) ? manifest->path_for(resource) : nullopt;
+
+    return (fingerprinted) ? *fingerprinted : resource;
+  });
+}
+
 void Controller::Instance::
 send_fatal_response(ResponseWriter &response, const Rest::Request& request, 
 Code code, const std::string public_what = "Internal Server Error") {
@@ -23,8 +40,115 @@ Code code, const std::string public_what = "Internal Server Error") {
   }
 }
 
+// Acquires each of the limits in turn. If a later limit sheds the request, the
+// earlier ones are released:
+static void AcquireAll(const vector<AdmissionControl *> &limits, size_t i, 
+  const AdmissionControl::Continuation &done) {
+  if (i == limits.size()) return done(true);
+
+  limits[i]->acquire([limits, i, done](bool is_admitted) {
+    if (is_admitted) return AcquireAll(limits, i+1, done);
+    for (size_t j = 0; j < i; j++) limits[j]->release();
+    done(false);
+  });
+}
+
+// Routes are limited by "Controller#action", or for every action in the
+// controller, by "Controller#*". The latter share a single limiter:
+void Controller::Instance::bind_rate_limit(const string &action, ConfigParser &config) {
+  auto rate_limits = config.rate_limits();
+
+  string route = controller_name+"#"+action;
+  auto limit = rate_limits.find(route);
+  if (limit == rate_limits.end()) {
+    route = controller_name+"#*";
+    limit = rate_limits.find(route);
+    if (limit == rate_limits.end()) return;
+  }
+
+  auto &limiter = rate_limiters[route];
+  if (!limiter)
+    limiter = make_shared<RateLimiter>(limit->second.rate, limit->second.burst, 
+      config.rate_limit_max_clients());
+
+  action_rate_limits[action] = RateLimit({ limiter, limit->second.is_by_authorizer,
+    make_shared<prails::HttpHeader>("Retry-After", 
+      to_string(static_cast<unsigned int>(ceil(1 / limit->second.rate)))),
+    &Metrics::GetCounter(fmt::format(
+      "prails_requests_rate_limited_total{{controller=\"{}\",action=\"{}\"}}", 
+      controller_name, action), "Requests refused with a 429, by rate limit.") });
+}
+
+// Admits the request, and runs the action, either here or on a worker. With
+// neither a limit, nor a worker pool, this is just a call to run_action():
 void Controller::Instance::
 route_action(string action, const Rest::Request& request, ResponseWriter response) {
+  // Rate limits are checked before anything else, so that a client who's over
+  // their limit never costs us a body parse, or a database session:
+  if (auto limit = action_rate_limits.find(action); limit != action_rate_limits.end()) {
+    optional<string> authorizer_key;
+    if (limit->second.is_by_authorizer)
+      try {
+        authorizer_key = rate_limit_key(request, action);
+      } catch(const AccessDenied &e) { 
+        logger->error("AccessDenied at {}#{}: {}", controller_name, action, e.what());
+        return send_fatal_response(response, request, Code::Bad_Request, 
+          e.public_what());
+      } catch(const exception &e) { 
+        logger->error("Exception at {}#{}: {}", controller_name, action, e.what());
+        return send_fatal_response(response, request, Code::Internal_Server_Error);
+      }
+
+    if (!limit->second.limiter->allow((authorizer_key) ? "authorizer:"+*authorizer_key :
+      "address:"+request.address().host())) {
+      limit->second.limited->increment();
+      response.headers().add(limit->second.retry_after);
+      response.send(Code::Too_Many_Requests, "Too Many Requests", MIME(Text, Plain));
+      return;
+    }
+  }
+
+  vector<AdmissionControl *> limits;
+  if (server_admission) limits.push_back(server_admission.get());
+  if (auto limit = action_admission.find(action); limit != action_admission.end())
+    limits.push_back(limit->second.get());
+
+  if (limits.empty() && !workers) 
+    return run_action(action, request, std::move(response));
+
+  // A queued request may be admitted long after pistache has moved on from this
+  // one. So, the request is copied:
+  auto writer = make_shared<ResponseWriter>(std::move(response));
+  AcquireAll(limits, 0, [this, action, request, writer, limits](bool is_admitted) {
+    if (!is_admitted) return send_shed_response(action, *writer);
+
+    auto run = [this, action, request, writer, limits]() {
+      run_action(action, request, std::move(*writer));
+      for (auto limit : limits) limit->release();
+    };
+
+    // Continuations may be called from the admission control's dispatcher, 
+    // which mustn't run the action itself. That's why a queue requires workers
+    // (See ConfigParser). Without either, we're still on the request's thread:
+    if (workers) workers->submit(run); else run();
+  });
+}
+
+// This is cheap, since we're shedding because we're busy. The body is constant,
+// and the Retry-After header is shared between every response:
+void Controller::Instance::send_shed_response(const string &action, 
+  ResponseWriter &response) {
+  static const string body = "Service Unavailable";
+
+  if (auto shed = action_shed.find(action); shed != action_shed.end()) 
+    shed->second->increment();
+
+  response.headers().add(retry_after);
+  response.send(Code::Service_Unavailable, body, MIME(Text, Plain));
+}
+
+void Controller::Instance::
+run_action(const string &action, const Rest::Request& request, ResponseWriter response) {
 
   // This was copied out of pistache/src/common/http.cc, and seems to be needed
   // in order to get stringified requests from request.method()
@@ -39,24 +163,86 @@ route_action(string action, const Rest::Request& request, ResponseWriter respons
     controller_name, action, request.address().host() );
   
 
+  auto started = chrono::steady_clock::now();
+  Code code;
+
+  // The model and controller layers report to this, for the Server-Timing header,
+  // and the slow request log:
+  bool is_logging_slow = (slow_request_threshold.count() > 0);
+  RequestTiming timing;
+  optional<RequestTiming::Scope> timing_scope;
+  if (is_server_timing || is_logging_slow) {
+    timing.send_header(is_server_timing);
+    timing.capture_queries(is_logging_slow);
+    timing_scope.emplace(timing);
+  }
+
   try {
     if (actions.count(action) == 0)
       throw RequestException("Missing action binding in controller.");
 
     logger->debug("Routing: {}", route_description );
 
-    actions[action](request).send(response);
+    auto action_response = actions[action](request);
+    code = static_cast<Code>(action_response.code());
+    action_response.send(response);
     
   } catch(const AccessDenied &e) { 
     logger->error("AccessDenied at {}: {}", route_description, e.what());
-    send_fatal_response(response, request, Code::Bad_Request, e.public_what());
+    code = Code::Bad_Request;
+    send_fatal_response(response, request, code, e.public_what());
   } catch(const RequestException &e) { 
     logger->error("RequestException at {}: {}", route_description, e.what());
-    send_fatal_response(response, request, Code::Internal_Server_Error, e.public_what());
+    code = Code::Internal_Server_Error;
+    send_fatal_response(response, request, code, e.public_what());
   } catch(const exception &e) { 
     logger->error("Exception at {}: {}", route_description, e.what());
-    send_fatal_response(response, request, Code::Internal_Server_Error);
+    code = Code::Internal_Server_Error;
+    send_fatal_response(response, request, code);
   }
+
+  if (auto metrics = action_metrics.find(action); metrics != action_metrics.end())
+    metrics->second->record(static_cast<unsigned int>(code), 
+      chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now()-started).count());
+
+  if (is_logging_slow && (timing.elapsed() >= slow_request_threshold))
+    log_slow_request(request, action, code, timing);
+}
+
+void Controller::Instance::log_slow_request(const Rest::Request& request, 
+  const string &action, Code code, const RequestTiming &timing) {
+
+  auto queries = json::array();
+  for (const auto &query : timing.queries())
+    queries.push_back({ {"statement", query.statement}, 
+      {"duration_ms", RequestTiming::Milliseconds(query.duration)},
+      {"rows", (query.rows) ? json(*query.rows) : json(nullptr)} });
+
+  auto phases = json::object();
+  for (const auto &[phase, name] : vector<pair<RequestTiming::Phase, string>>({
+    {RequestTiming::Authorization, "authorization_ms"}, 
+    {RequestTiming::BodyParsing, "body_parsing_ms"},
+    {RequestTiming::Database, "database_ms"}, 
+    {RequestTiming::Rendering, "rendering_ms"}, 
+    {RequestTiming::Serialization, "serialization_ms"} }))
+    phases[name] = RequestTiming::Milliseconds(timing.duration(phase));
+
+  json record = { 
+    {"controller", controller_name}, 
+    {"action", action},
+    {"method", Http::methodString(request.method())},
+    {"resource", request.resource()},
+    {"query", request.query().as_str()},
+    {"body_bytes", request.body().size()},
+    {"client", request.address().host()},
+    {"status", static_cast<unsigned int>(code)},
+    {"duration_ms", RequestTiming::Milliseconds(timing.elapsed())},
+    {"phases", phases},
+    {"queries", queries} };
+
+  logger->warn("Slow Request: {}", 
+    record.dump(-1, ' ', false, json::error_handler_t::replace));
 }
 
 
@@ -93,6 +279,8 @@ string Controller::Instance::
 ensure_view_file(string filename, string controller_folder) {
   string ret = views_path+"/"+controller_folder+"/"+filename;
 
+  if (FindEmbeddedView(views_path, ret)) return ret;
+
   if (!path_is_readable(ret) && filesystem::is_regular_file(ret))
     throw RequestException("Attemping to load, but unable to read file {}.", ret);
 
@@ -103,37 +291,87 @@ string Controller::Instance::ensure_view_file(string filename) {
   return ensure_view_file(filename, controller_name);
 }
 
-Controller::Response Controller::Instance::
-render_js(string action, json tmpl) {
-  string view_file = ensure_view_file(action+".inja.js");
+// Views that were compiled into the binary are found by their path, relative to
+// the views_path:
+optional<string_view> Controller::Instance::
+FindEmbeddedView(const string &views_path, const string &path) {
+  if ((path.size() <= views_path.size()) || (path[views_path.size()] != '/') ||
+    (path.compare(0, views_path.size(), views_path) != 0))
+    return nullopt;
 
-  inja::Environment env;
+  return EmbeddedViews::Find(path.substr(views_path.size()+1));
+}
 
-  env.add_callback("include_as_string", 1, [view_file](inja::Arguments& args) {
-    auto filename = args.at(0)->get<string>();
-    string include_file_path = string(filesystem::path(view_file).parent_path())+"/"+filename;
-    return json{read_file(include_file_path)}[0].dump();
+// Every controller parses its views once, into a cache of its own. Views are 
+// revalidated against their mtimes, unless we're in production. Embedded views
+// are preferred to those on disk:
+shared_ptr<TemplateCache> Controller::Instance::
+CreateTemplateCache(const string &view_cache, const string &views_path) {
+  return make_shared<TemplateCache>(view_cache == "development", 
+    [views_path](inja::Environment &env) {
+    AddAssetCallbacks(env);
+
+    // ie, {{ include_as_string("template.html") }}, relative to the view:
+    env.add_callback("include_as_string", 1, [views_path](inja::Arguments& args) {
+      auto filename = args.at(0)->get<string>();
+      string include_file_path = string(filesystem::path(
+        TemplateCache::RenderingPath()).parent_path())+"/"+filename;
+
+      auto embedded = FindEmbeddedView(views_path, include_file_path);
+      if (auto includes = GetIncludeStore(); includes)
+        return *includes->get(include_file_path, embedded);
+
+      return json{(embedded) ? string(*embedded) : 
+        read_file(include_file_path)}[0].dump();
+    });
+
+    // ie, {{ cache("tasks/sidebar", 60, "_sidebar.inja.html", sidebar) }}. The
+    // partial is relative to the view, and is rendered with the (optional) data,
+    // at most once per ttl:
+    for (unsigned int arity : {3u, 4u})
+      env.add_callback("cache", arity, [](inja::Arguments& args) {
+        auto key = args.at(0)->get<string>();
+        auto ttl = chrono::seconds(args.at(1)->get<unsigned int>());
+        string partial_path = string(filesystem::path(
+          TemplateCache::RenderingPath()).parent_path())+"/"+
+          args.at(2)->get<string>();
+        json data = (args.size() > 3) ? *args.at(3) : json::object();
+
+        auto templates = TemplateCache::Rendering();
+        auto render = [&]() { return templates->render(partial_path, data); };
+
+        auto fragments = GetFragmentCache();
+        return (fragments) ? fragments->fetch(key, ttl, render) : render();
+      });
+  }, [views_path](const string &path) { 
+    return FindEmbeddedView(views_path, path); 
   });
+}
+
+Controller::Response Controller::Instance::
+render_js(string action, json tmpl) {
+  RequestTiming::Timer timer(RequestTiming::Rendering);
+  string view_file = views_path+"/"+controller_name+"/"+action+".inja.js";
 
   tmpl["controller"] = controller_name; 
   tmpl["action"] = action; 
 
-  return Controller::Response(200, "text/javascript", env.render_file(view_file, tmpl));
+  return Controller::Response(200, "text/javascript", 
+    templates->render(view_file, tmpl));
 }
 
 Controller::Response Controller::Instance::
 render_html(string layout, string action, json tmpl) {
-  string view_file = ensure_view_file(action+".inja.html");
-  string layout_file = ensure_view_file(layout+".inja.html", "layouts");
-
-  inja::Environment env;
+  RequestTiming::Timer timer(RequestTiming::Rendering);
+  string view_file = views_path+"/"+controller_name+"/"+action+".inja.html";
+  string layout_file = views_path+"/layouts/"+layout+".inja.html";
 
   tmpl["controller"] = controller_name; 
   tmpl["action"] = action; 
   tmpl["layout"] = layout; 
-  tmpl["content"]  = env.render_file(view_file, tmpl); 
 
-  return Controller::Response(200, "text/html", env.render_file(layout_file, tmpl));
+  return Controller::Response(200, "text/html", 
+    templates->render(layout_file, view_file, tmpl));
 }
 
 Controller::Response Controller::Instance::
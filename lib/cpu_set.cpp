@@ -0,0 +1,86 @@
+#include <regex>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "spdlog/spdlog.h"
+
+#include "cpu_set.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+CpuSet::CpuSet(const string &list) {
+  if (!regex_match(list, regex("^\\d+(?:-\\d+)?(?:,\\d+(?:-\\d+)?)*$")))
+    throw invalid_argument("Invalid cpu list \""+list+"\"");
+
+  for (const auto &range : split(list, ",")) {
+    auto dash = range.find('-');
+    unsigned int first = stoul(range.substr(0, dash));
+    unsigned int last = (dash == string::npos) ? first : stoul(range.substr(dash+1));
+
+    if ((last < first) || (last >= CPU_SETSIZE))
+      throw invalid_argument("Invalid cpu range \""+range+"\"");
+
+    for (unsigned int cpu = first; cpu <= last; cpu++) cpus_.push_back(cpu);
+  }
+
+  sort(cpus_.begin(), cpus_.end());
+  cpus_.erase(unique(cpus_.begin(), cpus_.end()), cpus_.end());
+}
+
+bool CpuSet::pin(pid_t tid) const {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus_) CPU_SET(cpu, &set);
+
+  if (sched_setaffinity(tid, sizeof(set), &set) == 0) return true;
+
+  // Threads come and go, between our listing them, and our pinning them:
+  if ((tid != 0) && (errno == ESRCH)) return false;
+
+  throw runtime_error(fmt::format("Unable to pin thread {} to cpus {}: {}", tid,
+    to_string(), strerror(errno)));
+}
+
+CpuSet CpuSet::OfThread(pid_t tid) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(tid, sizeof(set), &set) != 0)
+    throw runtime_error(fmt::format("Unable to read the cpus of thread {}: {}", tid,
+      strerror(errno)));
+
+  CpuSet ret;
+  for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if (CPU_ISSET(cpu, &set)) ret.cpus_.push_back(cpu);
+  return ret;
+}
+
+pid_t CpuSet::CurrentThread() { return static_cast<pid_t>(syscall(SYS_gettid)); }
+
+// The i'th cpu of the set (wrapping around), as a set of its own:
+CpuSet CpuSet::at(size_t i) const {
+  if (cpus_.empty()) throw out_of_range("Empty cpu set");
+
+  CpuSet ret;
+  ret.cpus_.push_back(cpus_[i % cpus_.size()]);
+  return ret;
+}
+
+string CpuSet::to_string() const {
+  vector<string> ranges;
+  for (size_t i = 0; i < cpus_.size(); ) {
+    size_t j = i;
+    while ((j+1 < cpus_.size()) && (cpus_[j+1] == cpus_[j]+1)) j++;
+    ranges.push_back((i == j) ? std::to_string(cpus_[i]) : 
+      fmt::format("{}-{}", cpus_[i], cpus_[j]));
+    i = j+1;
+  }
+  return join(ranges, ",");
+}
@@ -0,0 +1,21 @@
+#include "embedded_views.hpp"
+
+using namespace std;
+
+EmbeddedViews::EmbeddedViews(const View *views, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    Views()[views[i].path] = string_view(views[i].content, views[i].size);
+}
+
+map<string, string_view> &EmbeddedViews::Views() {
+  static map<string, string_view> views;
+  return views;
+}
+
+optional<string_view> EmbeddedViews::Find(const string &path) {
+  auto &views = Views();
+  if (views.empty()) return nullopt;
+
+  auto view = views.find(path);
+  return (view == views.end()) ? nullopt : make_optional(view->second);
+}
@@ -0,0 +1,133 @@
+#include <filesystem>
+#include <stdexcept>
+#include <climits>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#include "file_watcher.hpp"
+
+using namespace std;
+
+const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+  IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+
+FileWatcher::FileWatcher(const string &root) : root(root) {
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    throw runtime_error("Unable to initialize inotify for "+root);
+
+  stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stop_fd < 0) {
+    close(inotify_fd);
+    throw runtime_error("Unable to create the FileWatcher stop descriptor");
+  }
+}
+
+// Destructors mustn't throw. Should we be unable to signal the watcher thread, 
+// it still notices that we're no longer running, the next time its poll() times
+// out. So, the join is safe either way:
+FileWatcher::~FileWatcher() {
+  signal_stop();
+  if (watcher.joinable()) watcher.join();
+  close(stop_fd);
+  close(inotify_fd);
+}
+
+void FileWatcher::subscribe(Callback callback) {
+  lock_guard<mutex> guard(subscribers_mutex);
+  subscribers.push_back(callback);
+}
+
+void FileWatcher::start() {
+  if (running) return;
+
+  watch_tree(root);
+
+  running = true;
+  watcher = thread(&FileWatcher::watch_loop, this);
+}
+
+void FileWatcher::stop() {
+  if (!running) return;
+
+  if (!signal_stop())
+    throw runtime_error("Unable to signal the FileWatcher thread");
+
+  if (watcher.joinable()) watcher.join();
+}
+
+bool FileWatcher::signal_stop() noexcept {
+  running = false;
+
+  uint64_t one = 1;
+  return (write(stop_fd, &one, sizeof(one)) >= 0);
+}
+
+void FileWatcher::watch_tree(const string &path) {
+  error_code ec;
+  if (!filesystem::is_directory(path, ec)) return;
+
+  int wd = inotify_add_watch(inotify_fd, path.c_str(), WatchMask);
+  if (wd < 0) return;
+  watch_paths[wd] = path;
+
+  for (const auto &entry : filesystem::directory_iterator(path, ec))
+    if (entry.is_directory(ec) && !entry.is_symlink(ec))
+      watch_tree(entry.path().string());
+}
+
+void FileWatcher::watch_loop() {
+  // The kernel guarantees that this is large enough for at least one event:
+  alignas(struct inotify_event) char buffer[64 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+
+  struct pollfd fds[2] = { {inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0} };
+
+  while (running) {
+    if (poll(fds, 2, StopPollMs) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) break;
+    if (!(fds[0].revents & POLLIN)) continue;
+
+    ssize_t len;
+    while ((len = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+      for (char *ptr = buffer; ptr < buffer + len; ) {
+        auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+        ptr += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+          // We lost track of what changed. Assume that everything did:
+          dispatch(root);
+          continue;
+        }
+
+        if (watch_paths.count(event->wd) == 0) continue;
+
+        string path = watch_paths[event->wd];
+        if (event->len > 0) path += "/"+string(event->name);
+
+        if (event->mask & IN_IGNORED) {
+          watch_paths.erase(event->wd);
+          continue;
+        }
+
+        // New directories need their own watch, and the files within them
+        // may have been created before that watch existed:
+        if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && (event->mask & IN_ISDIR))
+          watch_tree(path);
+
+        dispatch(path);
+      }
+    }
+  }
+}
+
+void FileWatcher::dispatch(const string &path) {
+  lock_guard<mutex> guard(subscribers_mutex);
+  for (const auto &callback : subscribers) callback(path);
+}
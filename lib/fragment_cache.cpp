@@ -0,0 +1,133 @@
+#include "fragment_cache.hpp"
+#include "metrics.hpp"
+
+using namespace std;
+
+FragmentCache::FragmentCache(size_t max_bytes) : max_bytes(max_bytes) {}
+
+// The key is stored twice, once in the map, and once in the used list:
+size_t FragmentCache::Footprint(const string &key, const string &value) {
+  return key.size()*2+value.size();
+}
+
+optional<string> FragmentCache::get(const string &key) {
+  static auto &hits = Metrics::GetCounter("prails_fragment_cache_hits_total",
+    "Fragments that were served from the fragment cache.");
+  static auto &misses = Metrics::GetCounter("prails_fragment_cache_misses_total",
+    "Fragments that were missing from the fragment cache, or had expired.");
+
+  lock_guard<std::mutex> lock(mutex);
+
+  auto fragment = fragments.find(key);
+  if (fragment == fragments.end()) {
+    misses.increment();
+    return nullopt;
+  }
+
+  if (fragment->second.expires_at <= Clock::now()) {
+    erase(fragment);
+    misses.increment();
+    return nullopt;
+  }
+
+  used.splice(used.begin(), used, fragment->second.used);
+  hits.increment();
+  return fragment->second.value;
+}
+
+void FragmentCache::set(const string &key, string value, chrono::seconds ttl) {
+  lock_guard<std::mutex> lock(mutex);
+
+  if (auto existing = fragments.find(key); existing != fragments.end())
+    erase(existing);
+
+  size_t footprint = Footprint(key, value);
+  if (footprint > max_bytes) return;
+
+  while (bytes_+footprint > max_bytes)
+    erase(fragments.find(used.back()));
+
+  used.push_front(key);
+  fragments.emplace(key, Fragment({std::move(value), Clock::now()+ttl, 
+    used.begin()}));
+  bytes_ += footprint;
+}
+
+string FragmentCache::fetch(const string &key, chrono::seconds ttl, 
+  const function<string()> &render) {
+  if (auto fragment = get(key); fragment) return *fragment;
+
+  // Only one thread renders a missing fragment. Any others that want it in the 
+  // meantime, wait on that render, rather than each rendering it again:
+  promise<string> rendered;
+  shared_future<string> pending;
+  {
+    lock_guard<std::mutex> lock(mutex);
+
+    // (It may have been cached, since we missed it above)
+    auto fragment = fragments.find(key);
+    if ((fragment != fragments.end()) && 
+      (fragment->second.expires_at > Clock::now()))
+      return fragment->second.value;
+
+    if (auto rendering = renders.find(key); rendering != renders.end())
+      pending = rendering->second;
+    else
+      renders.emplace(key, rendered.get_future().share());
+  }
+
+  if (pending.valid()) return pending.get();
+
+  try {
+    string ret = render();
+    set(key, ret, ttl);
+    rendered.set_value(ret);
+    finish(key);
+    return ret;
+  } catch (...) {
+    // The waiting threads see the same exception that we do:
+    rendered.set_exception(current_exception());
+    finish(key);
+    throw;
+  }
+}
+
+void FragmentCache::finish(const string &key) {
+  lock_guard<std::mutex> lock(mutex);
+  renders.erase(key);
+}
+
+size_t FragmentCache::erase_prefix(const string &prefix) {
+  lock_guard<std::mutex> lock(mutex);
+
+  size_t ret = 0;
+  for (auto fragment = fragments.lower_bound(prefix); 
+    (fragment != fragments.end()) && 
+    (fragment->first.compare(0, prefix.size(), prefix) == 0); ret++)
+    erase(fragment++);
+
+  return ret;
+}
+
+void FragmentCache::clear() {
+  lock_guard<std::mutex> lock(mutex);
+  fragments.clear();
+  used.clear();
+  bytes_ = 0;
+}
+
+size_t FragmentCache::size() {
+  lock_guard<std::mutex> lock(mutex);
+  return fragments.size();
+}
+
+size_t FragmentCache::bytes() {
+  lock_guard<std::mutex> lock(mutex);
+  return bytes_;
+}
+
+void FragmentCache::erase(map<string, Fragment>::iterator fragment) {
+  bytes_ -= Footprint(fragment->first, fragment->second.value);
+  used.erase(fragment->second.used);
+  fragments.erase(fragment);
+}
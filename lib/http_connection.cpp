@@ -0,0 +1,166 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "http_connection.hpp"
+
+using namespace std;
+
+optional<string> HttpConnection::Response::header(const string &name) const {
+  string lowercase = name;
+  transform(lowercase.begin(), lowercase.end(), lowercase.begin(), ::tolower);
+
+  auto value = headers.find(lowercase);
+  return (value == headers.end()) ? nullopt : make_optional(value->second);
+}
+
+HttpConnection::HttpConnection(const string &host, unsigned int port) :
+  host(host), port(port) {}
+
+HttpConnection::~HttpConnection() { disconnect(); }
+
+HttpConnection::Response HttpConnection::request(const string &method,
+  const string &path, const string &body, const map<string, string> &headers) {
+  string raw = method+" "+path+" HTTP/1.1\r\nHost: "+host+"\r\n";
+  for (const auto &[name, value] : headers) raw += name+": "+value+"\r\n";
+  if (!body.empty() || (method == "POST") || (method == "PUT"))
+    raw += "Content-Length: "+to_string(body.size())+"\r\n";
+  raw += "\r\n"+body;
+
+  // A connection that we're re-using, may have been closed by the server while
+  // it sat idle. In which case, we'll know by the time that we try to read:
+  for (bool is_reused = is_connected(); ; is_reused = false) {
+    if (!is_connected()) connect();
+
+    if (write_all(raw) && (!buffer.empty() || fill())) break;
+
+    disconnect();
+    if (!is_reused)
+      throw runtime_error("Connection to "+host+":"+to_string(port)+" was closed");
+  }
+
+  try {
+    auto ret = read_response(method == "HEAD");
+    auto connection = ret.header("connection");
+    if (connection && (*connection == "close")) disconnect();
+    return ret;
+  } catch (...) {
+    disconnect();
+    throw;
+  }
+}
+
+void HttpConnection::connect() {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo *addresses = nullptr;
+  if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses) != 0)
+    throw runtime_error("Unable to resolve "+host);
+
+  for (auto address = addresses; address != nullptr; address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+
+  if (fd < 0)
+    throw runtime_error("Unable to connect to "+host+":"+to_string(port));
+
+  // Our requests are written in a single send, so there's nothing to coalesce:
+  int nodelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+}
+
+void HttpConnection::disconnect() {
+  if (fd >= 0) close(fd);
+  fd = -1;
+  buffer.clear();
+}
+
+bool HttpConnection::write_all(const string &data) {
+  for (size_t sent = 0; sent < data.size(); ) {
+    ssize_t n = send(fd, data.data()+sent, data.size()-sent, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+bool HttpConnection::fill() {
+  char chunk[16384];
+  ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+  if (n <= 0) return false;
+  buffer.append(chunk, n);
+  return true;
+}
+
+string HttpConnection::read_line() {
+  size_t end;
+  while ((end = buffer.find("\r\n")) == string::npos)
+    if (!fill()) throw runtime_error("Connection closed mid-response");
+
+  string ret = buffer.substr(0, end);
+  buffer.erase(0, end+2);
+  return ret;
+}
+
+string HttpConnection::read_bytes(size_t length) {
+  while (buffer.size() < length)
+    if (!fill()) throw runtime_error("Connection closed mid-response");
+
+  string ret = buffer.substr(0, length);
+  buffer.erase(0, length);
+  return ret;
+}
+
+HttpConnection::Response HttpConnection::read_response(bool is_head) {
+  Response ret;
+
+  // ie "HTTP/1.1 200 OK":
+  string status_line = read_line();
+  if ((status_line.size() < 12) || (status_line.compare(0, 5, "HTTP/") != 0))
+    throw runtime_error("Malformed status line \""+status_line+"\"");
+  ret.status = stoi(status_line.substr(9, 3));
+
+  for (string line = read_line(); !line.empty(); line = read_line()) {
+    auto colon = line.find(':');
+    if (colon == string::npos) continue;
+
+    string name = line.substr(0, colon);
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    auto value_at = line.find_first_not_of(" \t", colon+1);
+    ret.headers[name] = (value_at == string::npos) ? "" : line.substr(value_at);
+  }
+
+  if (is_head || (ret.status == 204) || (ret.status == 304) || (ret.status < 200))
+    return ret;
+
+  auto encoding = ret.header("transfer-encoding");
+  if (encoding && (encoding->find("chunked") != string::npos)) {
+    for (size_t length; (length = stoul(read_line(), nullptr, 16)) > 0; ) {
+      ret.body += read_bytes(length);
+      read_line();
+    }
+    // Any trailers are ignored:
+    while (!read_line().empty());
+  } else if (auto length = ret.header("content-length"); length)
+    ret.body = read_bytes(stoul(*length));
+  else {
+    // Without a length, the body runs until the server closes the connection:
+    while (fill());
+    ret.body = std::move(buffer);
+    disconnect();
+  }
+
+  return ret;
+}
@@ -0,0 +1,90 @@
+#include <mutex>
+#include <cstdio>
+#include <sys/stat.h>
+
+#include "include_store.hpp"
+#include "mapped_file.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+IncludeStore::Escaped IncludeStore::get(const string &path, 
+  optional<string_view> content) {
+  unsigned long loading_generation;
+  {
+    shared_lock<shared_mutex> lock(mutex);
+    if (auto file = files.find(path); file != files.end()) return file->second;
+    loading_generation = generation;
+  }
+
+  auto ret = make_shared<const string>((content) ? Escape(*content) : Load(path));
+
+  // The file may have changed while we loaded it. If so, the next get() will 
+  // load it again:
+  unique_lock<shared_mutex> lock(mutex);
+  if (loading_generation == generation) files.emplace(path, ret);
+  return ret;
+}
+
+// Returns the file's content, escaped:
+string IncludeStore::Load(const string &path) {
+  struct stat st;
+  if ((stat(path.c_str(), &st) == 0) && 
+    (static_cast<size_t>(st.st_size) >= MinMappedSize)) {
+    MappedFile mapped(path);
+    if (mapped.is_mapped()) return Escape(string_view(mapped.data(), mapped.size()));
+  }
+
+  return Escape(read_file(path));
+}
+
+void IncludeStore::invalidate(const string &path) {
+  unique_lock<shared_mutex> lock(mutex);
+  generation++;
+
+  files.erase(path);
+  for (auto file = files.lower_bound(path+"/"); (file != files.end()) && 
+    (file->first.compare(0, path.size()+1, path+"/") == 0); )
+    file = files.erase(file);
+}
+
+void IncludeStore::clear() {
+  unique_lock<shared_mutex> lock(mutex);
+  generation++;
+  files.clear();
+}
+
+size_t IncludeStore::size() {
+  shared_lock<shared_mutex> lock(mutex);
+  return files.size();
+}
+
+// This matches nlohmann::json's dump() of a string. Multibyte characters are 
+// passed through as is:
+string IncludeStore::Escape(string_view text) {
+  string ret;
+  ret.reserve(text.size()+text.size()/8+2);
+  ret.push_back('"');
+
+  for (char c : text)
+    switch (c) {
+      case '"':  ret += "\\\""; break;
+      case '\\': ret += "\\\\"; break;
+      case '\b': ret += "\\b"; break;
+      case '\f': ret += "\\f"; break;
+      case '\n': ret += "\\n"; break;
+      case '\r': ret += "\\r"; break;
+      case '\t': ret += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[7];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          ret += escaped;
+        } else
+          ret.push_back(c);
+    }
+
+  ret.push_back('"');
+  return ret;
+}
@@ -1,13 +1,21 @@
 
 #include <iostream>
+#include <fstream>
+#include <chrono>
 #include <filesystem>
-
-#include "httplib.h"
+#include <map>
+#include <thread>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "prails.hpp"
 #include "server.hpp"
 #include "model.hpp"
 #include "controller_factory.hpp"
+#include "asset_manifest.hpp"
+#include "http_connection.hpp"
+#include "page_exporter.hpp"
 
 using namespace std;
 using namespace Pistache;
@@ -26,6 +34,9 @@ constexpr std::string_view help_output {
   "  server         Run in server mode.\n"
   "  migrate        Run model migrations.\n"
   "  output URL [FILE]  Output a URL to stdout (default) or [FILE].\n"
+  "  export DIR URL|FILE...  Render the URLs, and those listed in each FILE (a\n"
+  "                 sitemap, or one URL per line), into DIR.\n"
+  "  assets         Fingerprint the static resources, and write the asset manifest.\n"
   "The supplied CONFIG_FILE is expected to be a yaml-formatted server configuration file.\n"
   "(See https://en.wikipedia.org/wiki/YAML for details on the YAML file format.)\n\n"
 };
@@ -36,10 +47,116 @@ unsigned int mode_help(ConfigParser &, shared_ptr<spdlog::logger>, const vector<
   return 1;
 }
 
+// A preforked worker. Its sessions were inherited from the supervisor, and are 
+// replaced with its own. SIGTERM and SIGINT shut the server down gracefully, which finishes
+// the requests that are underway:
+static unsigned int run_worker(ConfigParser &config, shared_ptr<spdlog::logger> logger,
+  unsigned int index) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+
+  // The server's threads inherit this mask, leaving the signals to our sigwait:
+  pthread_sigmask(SIG_SETMASK, &signals, nullptr);
+
+  ModelFactory::Reconnect();
+
+  Server server(config);
+  server.startThreaded();
+  logger->info("Worker {} (pid {}) started", index, getpid());
+
+  int signal;
+  sigwait(&signals, &signal);
+
+  logger->info("Worker {} (pid {}) shutting down", index, getpid());
+  server.shutdown();
+  return 0;
+}
+
+// Forks the workers, and restarts any that exit, until we're asked to stop. At
+// which point, the signal is forwarded to every worker, and we wait on them to
+// drain. Signals are blocked, and taken synchronously, so that none are missed
+// between our checks:
+static unsigned int run_supervisor(ConfigParser &config, 
+  shared_ptr<spdlog::logger> logger) {
+  map<pid_t, pair<unsigned int, chrono::steady_clock::time_point>> workers;
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  auto spawn = [&](unsigned int index) {
+    pid_t pid = fork();
+    if (pid < 0) throw runtime_error("Unable to fork a worker");
+    if (pid == 0) {
+      // The child mustn't unwind into our loop (and fork workers of its own):
+      try {
+        _exit(run_worker(config, logger, index));
+      } catch (const exception &e) {
+        logger->error("Worker {} (pid {}) failed: {}", index, getpid(), e.what());
+      } catch (...) {
+        logger->error("Worker {} (pid {}) failed", index, getpid());
+      }
+      logger->flush();
+      _exit(1);
+    }
+
+    workers[pid] = {index, chrono::steady_clock::now()};
+  };
+
+  for (unsigned int i = 0; i < config.workers(); i++) spawn(i);
+
+  bool is_stopping = false;
+  while (!workers.empty()) {
+    int signal = sigwaitinfo(&signals, nullptr);
+    if (signal < 0) continue;
+
+    if ((signal != SIGCHLD) && !is_stopping) {
+      is_stopping = true;
+      logger->info("Supervisor received signal {}, stopping {} workers", signal,
+        workers.size());
+      for (const auto &worker : workers) kill(worker.first, SIGTERM);
+      continue;
+    }
+
+    // Signals coalesce, so a single SIGCHLD may be for several workers:
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      auto worker = workers.find(pid);
+      if (worker == workers.end()) continue;
+      auto [index, started] = worker->second;
+      workers.erase(worker);
+
+      if (is_stopping) continue;
+
+      logger->error("Worker {} (pid {}) exited unexpectedly ({} {}). Restarting", 
+        index, pid, WIFSIGNALED(status) ? "signal" : "status", 
+        WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+
+      // A worker that can't stay up, shouldn't have us forking in a tight loop:
+      if (chrono::steady_clock::now()-started < chrono::seconds(1))
+        this_thread::sleep_for(chrono::seconds(1));
+
+      spawn(index);
+    }
+  }
+
+  return 0;
+}
+
 unsigned int mode_server(ConfigParser &config, shared_ptr<spdlog::logger> logger, const vector<string> & args) {
   string program_name = filesystem::path(args[0]).filename();
-  logger->info("{} log started. Cores={} Threads={}", program_name,
-    hardware_concurrency(), config.threads());
+  logger->info("{} log started. Cores={} Processes={} Threads={} WorkerThreads={}", 
+    program_name, hardware_concurrency(), config.workers(), config.threads(), 
+    config.worker_threads());
+
+  if (config.workers() > 1) return run_supervisor(config, logger);
+
   Server server(config);
   server.start();
   return 0;
@@ -57,6 +174,32 @@ unsigned int mode_migrate(ConfigParser &, shared_ptr<spdlog::logger> logger, con
   return 0;
 }
 
+unsigned int mode_assets(ConfigParser &config, shared_ptr<spdlog::logger> logger, const vector<string> &) {
+  logger->info("Fingerprinting {} into {}.", config.static_resource_path(), 
+    config.asset_manifest());
+
+  AssetManifest manifest(config.static_resource_path());
+  manifest.build();
+  manifest.save(config.asset_manifest());
+
+  logger->info("Fingerprinted {} assets.", manifest.size());
+
+  return 0;
+}
+
+// Starts a server in our process. Unless one is already running on our port, in
+// which case, we'll just query the existing process:
+static unique_ptr<Server> start_local_server(ConfigParser &config) {
+  auto server = make_unique<Server>(config);
+  try {
+    server->startThreaded();
+  } catch (const std::runtime_error &e) {
+    if (string(e.what()) != "Address already in use")
+      throw e;
+  }
+  return server;
+}
+
 unsigned int mode_output(ConfigParser &config, shared_ptr<spdlog::logger> logger, const vector<string> & args) {
   string url; 
   string output; 
@@ -69,37 +212,61 @@ unsigned int mode_output(ConfigParser &config, shared_ptr<spdlog::logger> logger
 
   logger->info("Outputting {} to {}.", url, (output.empty()) ? "STDOUT" : output);
 
-  Server server(config);
-  try {
-    server.startThreaded();
-  } catch (const std::runtime_error &e) {
-    // We'll assume the server is already running, in this case, and just query
-    // the existing process.
-    if (string(e.what()) != "Address already in use")
-      throw e;
-  }
+  auto server = start_local_server(config);
 
-  auto addr = Pistache::Address(config.address(), config.port());
-  auto browser = httplib::Client(addr.host().c_str(), (uint16_t) addr.port());
-  auto res = browser.Get(url.c_str());
+  auto res = HttpConnection(config.address(), config.port()).request("GET", url);
 
-  if (res->status != 200)
+  if (res.status != 200)
     throw logic_error(fmt::format("Error when requesting resource: {}", 
-      res->status));
+      res.status));
 
   if (output.empty())
-    cout << res->body << endl;
+    cout << res.body << endl;
   else {
     std::ofstream out(output);
-    out << res->body;
+    out << res.body;
     out.close();
   }
 
-  server.shutdown();
+  server->shutdown();
 
   return 0;
 }
 
+unsigned int mode_export(ConfigParser &config, shared_ptr<spdlog::logger> logger, const vector<string> & args) {
+  if (args.size() < 3) throw invalid_argument("Missing export parameter(s)");
+
+  string output = args[1];
+  vector<string> urls;
+  for (auto it = args.begin()+2; it != args.end(); it++)
+    if (starts_with(*it, "/"))
+      urls.push_back(*it);
+    else {
+      auto listed = PageExporter::ReadUrls(*it);
+      urls.insert(urls.end(), listed.begin(), listed.end());
+    }
+
+  // We keep a request in flight for every thread that renders, so that none of
+  // them sit idle:
+  unsigned int connections = max(config.threads(), config.worker_threads());
+  logger->info("Exporting {} urls to {}, over {} connections.", urls.size(), 
+    output, connections);
+
+  auto started = chrono::steady_clock::now();
+  auto server = start_local_server(config);
+
+  auto result = PageExporter(config.address(), config.port(), output, 
+    connections, logger).run(urls);
+
+  server->shutdown();
+
+  logger->info("Exported {} urls ({} failed) in {}ms.", result.exported, 
+    result.failed, chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now()-started).count());
+
+  return (result.failed > 0) ? 1 : 0;
+}
+
 int prails::main(int argc, char *argv[], map<string, ModeFunction> modes, 
   AppInitFunction appinit) {
 
@@ -112,6 +279,8 @@ int prails::main(int argc, char *argv[], map<string, ModeFunction> modes,
   if (!modes.count("help")) modes["help"] = mode_help;
   if (!modes.count("migrate")) modes["migrate"] = mode_migrate;
   if (!modes.count("output")) modes["output"] = mode_output;
+  if (!modes.count("export")) modes["export"] = mode_export;
+  if (!modes.count("assets")) modes["assets"] = mode_assets;
 
   // NOTE: We remove the entries in the args list as we recognize them. We
   //       save anything we don't recognize, for use below.
@@ -161,7 +330,7 @@ int prails::main(int argc, char *argv[], map<string, ModeFunction> modes,
 
     logger->info("Using config={}", config_path);
 
-    ModelFactory::Dsn("default", config.dsn(), config.threads());
+    ModelFactory::Dsn("default", config.dsn(), config.db_pool_size());
     Controller::Initialize(config);
 
     if (appinit) appinit(config, logger);
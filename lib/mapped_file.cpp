@@ -0,0 +1,31 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mapped_file.hpp"
+
+using namespace std;
+
+MappedFile::MappedFile(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+
+  struct stat st;
+  if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      data_ = static_cast<const char *>(mapped);
+      size_ = st.st_size;
+      // We're (probably) about to read this front to back:
+      madvise(mapped, size_, MADV_SEQUENTIAL);
+    }
+  }
+
+  // The mapping holds its own reference to the file:
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) munmap(const_cast<char *>(data_), size_);
+}
@@ -0,0 +1,223 @@
+#include <sstream>
+
+#include "spdlog/spdlog.h"
+
+#include "metrics.hpp"
+
+using namespace std;
+
+struct MetricsRegistry {
+  std::mutex mutex;
+  map<string, pair<string, unique_ptr<Metrics::Counter>>> counters;
+  map<string, pair<string, unique_ptr<Metrics::Histogram>>> histograms;
+  map<string, pair<string, function<double()>>> gauges;
+  map<pair<string, string>, unique_ptr<Metrics::Route>> routes;
+};
+
+static MetricsRegistry &Registry() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+// Metric names may carry labels (ie 'prails_db_pool_waiters{dsn="default"}'). 
+// This splits those into the name, and the label set (without braces):
+static pair<string, string> SplitLabels(const string &name) {
+  auto brace = name.find('{');
+  if (brace == string::npos) return {name, ""};
+  return {name.substr(0, brace), name.substr(brace+1, name.size()-brace-2)};
+}
+
+static string WithLabels(const string &name, const string &labels,
+  const string &extra = "") {
+  string all = labels;
+  if (!extra.empty()) all += ((all.empty()) ? "" : ",")+extra;
+  return (all.empty()) ? name : name+"{"+all+"}";
+}
+
+// We only write the HELP and TYPE once, for every series that shares a name:
+static void WriteHeader(ostringstream &out, string &last_name, const string &name,
+  const string &help, const string &type) {
+  if (name == last_name) return;
+  out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+  last_name = name;
+}
+
+static void WriteHistogram(ostringstream &out, const string &name,
+  const string &labels, const Metrics::Histogram &histogram) {
+  auto buckets = histogram.buckets();
+
+  size_t bucket = 0;
+  uint64_t cumulative = 0;
+  for (const auto &bound : Metrics::ExportedBounds) {
+    for (; (bucket < Metrics::Histogram::NumBuckets) &&
+      (Metrics::Histogram::BucketUpperBound(bucket) <= bound * 1000000); bucket++)
+      cumulative += buckets[bucket];
+
+    out << WithLabels(name+"_bucket", labels, fmt::format("le=\"{}\"", bound))
+      << " " << cumulative << "\n";
+  }
+
+  // The count and buckets are read separately, and may disagree by whatever was
+  // recorded in between. +Inf needs to agree with _count:
+  uint64_t count = histogram.count();
+  out << WithLabels(name+"_bucket", labels, "le=\"+Inf\"") << " " << count << "\n"
+    << WithLabels(name+"_sum", labels) << " "
+    << fmt::format("{}", static_cast<double>(histogram.sum()) / 1000000) << "\n"
+    << WithLabels(name+"_count", labels) << " " << count << "\n";
+}
+
+uint64_t Metrics::Counter::value() const {
+  uint64_t ret = 0;
+  for (const auto &shard : shards) ret += shard.value.load(memory_order_relaxed);
+  return ret;
+}
+
+size_t Metrics::Histogram::BucketIndex(uint64_t value) {
+  if (value < 16) return value;
+
+  // We don't distinguish between values beyond 2^36us (about 19 hours):
+  value = min(value, (uint64_t(1) << 36) - 1);
+
+  size_t msb = 63 - __builtin_clzll(value);
+  size_t sub_bucket = (value >> (msb - 3)) & 7;
+
+  return 16 + (msb - 4) * 8 + sub_bucket;
+}
+
+// Exclusive. ie, a bucket holds the values below this, and at or above the
+// upper bound of the bucket before it:
+uint64_t Metrics::Histogram::BucketUpperBound(size_t index) {
+  if (index < 16) return index + 1;
+
+  size_t msb = 4 + (index - 16) / 8;
+  uint64_t sub_bucket = (index - 16) % 8;
+
+  return ((8 + sub_bucket) << (msb - 3)) + (uint64_t(1) << (msb - 3));
+}
+
+void Metrics::Histogram::observe(uint64_t micros) {
+  auto &shard = shards[ShardIndex()];
+  shard.count.fetch_add(1, memory_order_relaxed);
+  shard.sum.fetch_add(micros, memory_order_relaxed);
+  shard.buckets[BucketIndex(micros)].fetch_add(1, memory_order_relaxed);
+}
+
+uint64_t Metrics::Histogram::count() const {
+  uint64_t ret = 0;
+  for (const auto &shard : shards) ret += shard.count.load(memory_order_relaxed);
+  return ret;
+}
+
+uint64_t Metrics::Histogram::sum() const {
+  uint64_t ret = 0;
+  for (const auto &shard : shards) ret += shard.sum.load(memory_order_relaxed);
+  return ret;
+}
+
+array<uint64_t, Metrics::Histogram::NumBuckets> Metrics::Histogram::buckets() const {
+  array<uint64_t, NumBuckets> ret{};
+  for (const auto &shard : shards)
+    for (size_t i = 0; i < NumBuckets; i++)
+      ret[i] += shard.buckets[i].load(memory_order_relaxed);
+  return ret;
+}
+
+Metrics::Route::~Route() {
+  for (auto &status : statuses) delete status.load();
+}
+
+void Metrics::Route::record(unsigned int status, uint64_t micros) {
+  if ((status < MinStatus) || (status > MaxStatus)) return;
+
+  auto &slot = statuses[status-MinStatus];
+  auto histogram = slot.load(memory_order_acquire);
+
+  if (!histogram) {
+    // Someone else may beat us to this. In which case, we use theirs:
+    auto allocated = new Histogram();
+    if (slot.compare_exchange_strong(histogram, allocated, memory_order_acq_rel))
+      histogram = allocated;
+    else
+      delete allocated;
+  }
+
+  histogram->observe(micros);
+}
+
+const Metrics::Histogram *Metrics::Route::status(unsigned int status) const {
+  if ((status < MinStatus) || (status > MaxStatus)) return nullptr;
+  return statuses[status-MinStatus].load(memory_order_acquire);
+}
+
+Metrics::Counter &Metrics::GetCounter(const string &name, const string &help) {
+  auto &registry = Registry();
+  lock_guard<std::mutex> guard(registry.mutex);
+
+  auto &counter = registry.counters[name];
+  if (!counter.second) counter = {help, make_unique<Counter>()};
+  return *counter.second;
+}
+
+Metrics::Histogram &Metrics::GetHistogram(const string &name, const string &help) {
+  auto &registry = Registry();
+  lock_guard<std::mutex> guard(registry.mutex);
+
+  auto &histogram = registry.histograms[name];
+  if (!histogram.second) histogram = {help, make_unique<Histogram>()};
+  return *histogram.second;
+}
+
+Metrics::Route &Metrics::GetRoute(const string &controller, const string &action) {
+  auto &registry = Registry();
+  lock_guard<std::mutex> guard(registry.mutex);
+
+  auto &route = registry.routes[{controller, action}];
+  if (!route) route = make_unique<Route>();
+  return *route;
+}
+
+void Metrics::SetGauge(const string &name, const string &help,
+  function<double()> gauge) {
+  auto &registry = Registry();
+  lock_guard<std::mutex> guard(registry.mutex);
+  registry.gauges[name] = {help, gauge};
+}
+
+string Metrics::Scrape() {
+  auto &registry = Registry();
+  lock_guard<std::mutex> guard(registry.mutex);
+
+  ostringstream out;
+  string last_name;
+
+  for (const auto &[name, counter] : registry.counters) {
+    auto [base, labels] = SplitLabels(name);
+    WriteHeader(out, last_name, base, counter.first, "counter");
+    out << name << " " << counter.second->value() << "\n";
+  }
+
+  for (const auto &[name, gauge] : registry.gauges) {
+    auto [base, labels] = SplitLabels(name);
+    WriteHeader(out, last_name, base, gauge.first, "gauge");
+    out << name << " " << fmt::format("{}", gauge.second()) << "\n";
+  }
+
+  for (const auto &[name, histogram] : registry.histograms) {
+    auto [base, labels] = SplitLabels(name);
+    WriteHeader(out, last_name, base, histogram.first, "histogram");
+    WriteHistogram(out, base, labels, *histogram.second);
+  }
+
+  for (const auto &[controller_action, route] : registry.routes) {
+    WriteHeader(out, last_name, "prails_request_duration_seconds",
+      "Time spent routing, and responding to, controller actions.", "histogram");
+
+    for (unsigned int status = Route::MinStatus; status <= Route::MaxStatus; status++)
+      if (auto histogram = route->status(status); histogram)
+        WriteHistogram(out, "prails_request_duration_seconds", fmt::format(
+          "controller=\"{}\",action=\"{}\",status=\"{}\"", controller_action.first,
+          controller_action.second, status), *histogram);
+  }
+
+  return out.str();
+}
@@ -0,0 +1,129 @@
+#include <atomic>
+#include <thread>
+#include <regex>
+#include <fstream>
+#include <filesystem>
+
+#include "page_exporter.hpp"
+#include "http_connection.hpp"
+#include "static_cache.hpp"
+#include "server.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+PageExporter::PageExporter(const string &host, unsigned int port,
+  const string &output_path, unsigned int connections,
+  shared_ptr<spdlog::logger> logger) : host(host), port(port),
+  output_path(remove_trailing_slash(output_path)),
+  connections(max(connections, 1u)), logger(logger) {}
+
+PageExporter::Result PageExporter::run(const vector<string> &urls) {
+  atomic<size_t> next(0), exported(0), failed(0);
+
+  auto exporter = [&]() {
+    HttpConnection connection(host, port);
+
+    for (size_t i; (i = next++) < urls.size(); ) {
+      const auto &url = urls[i];
+      try {
+        auto path = UrlToPath(url);
+        auto response = connection.request("GET", url);
+
+        if (response.status != 200) {
+          if (logger) logger->warn("Unable to export {}: status {}", url,
+            response.status);
+          failed++;
+          continue;
+        }
+
+        write(path, response.header("content-type").value_or(""), response.body);
+        exported++;
+      } catch (const exception &e) {
+        if (logger) logger->error("Unable to export {}: {}", url, e.what());
+        failed++;
+      }
+    }
+  };
+
+  vector<thread> threads;
+  for (unsigned int i = 1; i < min<size_t>(connections, urls.size()); i++)
+    threads.emplace_back(exporter);
+  exporter();
+  for (auto &t : threads) t.join();
+
+  Result ret;
+  ret.exported = exported;
+  ret.failed = failed;
+  return ret;
+}
+
+void PageExporter::write(const string &relative_path, const string &content_type,
+  const string &body) {
+  filesystem::path path = output_path+"/"+relative_path;
+  filesystem::create_directories(path.parent_path());
+
+  ofstream(path, ios::binary | ios::trunc) << body;
+
+  if (body.size() < MinGzipSize || content_type.empty() ||
+    !Server::IsCompressible(Pistache::Http::Mime::MediaType::fromString(content_type)))
+    return;
+
+  // We only write the sidecar if it's smaller, and remove any stale one if not:
+  auto gzip_path = path.string()+".gz";
+  if (auto gzip = StaticCache::Gzip(body); gzip && (gzip->size() < body.size()))
+    ofstream(gzip_path, ios::binary | ios::trunc) << *gzip;
+  else
+    filesystem::remove(gzip_path);
+}
+
+vector<string> PageExporter::ReadUrls(const string &path) {
+  if (!path_is_readable(path))
+    throw invalid_argument("Unable to read the url list "+path);
+
+  string content = read_file(path);
+  vector<string> ret;
+
+  if (content.find("<urlset") != string::npos) {
+    // A sitemap's urls are absolute, but we only want the path:
+    static const regex loc("<loc>\\s*([^<]*?)\\s*</loc>");
+    static const regex origin("^[a-zA-Z][a-zA-Z0-9+.-]*://[^/]*");
+
+    for (sregex_iterator it(content.begin(), content.end(), loc), end; it != end;
+      it++) {
+      string url = regex_replace((*it)[1].str(), origin, "");
+      url = replace_all(url, "&amp;", "&");
+      ret.push_back((url.empty()) ? "/" : url);
+    }
+
+    return ret;
+  }
+
+  for (auto line : split(content, "\n")) {
+    line = regex_replace(line, regex("^\\s+|\\s+$"), "");
+    if (line.empty() || line[0] == '#') continue;
+    ret.push_back(line);
+  }
+
+  return ret;
+}
+
+string PageExporter::UrlToPath(const string &url) {
+  if (url.empty() || url[0] != '/')
+    throw invalid_argument("Unable to export \""+url+"\": urls must begin with a /");
+
+  if (url.find_first_of("?#") != string::npos)
+    throw invalid_argument("Unable to export \""+url+"\": urls with a query "
+      "can't be represented as a file");
+
+  auto segments = split(url, "/");
+  if ((url.find("//") != string::npos) || has_any(segments, {".", ".."}))
+    throw invalid_argument("Unable to export \""+url+"\": invalid path");
+
+  // Paths without an extension are treated as a directory, with an index:
+  if (url.back() == '/') return url.substr(1)+"index.html";
+  if (segments.back().find('.') == string::npos) return url.substr(1)+"/index.html";
+
+  return url.substr(1);
+}
@@ -36,6 +36,7 @@ const string PostBody::urldecode ( const string& str) {
 }
 
 PostBody::PostBody(const string &encoded, unsigned int depth) : depth(depth) {
+  RequestTiming::Timer timer(RequestTiming::BodyParsing);
   const regex parameter_pairs(MatchPairs); 
   smatch res;
   
@@ -0,0 +1,51 @@
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+#include "rate_limiter.hpp"
+
+using namespace std;
+
+RateLimiter::RateLimiter(double rate, double burst, size_t max_clients) : 
+  rate_(rate), burst_(burst), 
+  max_per_shard(max<size_t>(1, (max_clients+NumShards-1) / NumShards)) {
+  if (rate <= 0) throw invalid_argument("A rate limit requires a rate above zero");
+  if (burst < 1) throw invalid_argument("A rate limit requires a burst of at least 1");
+}
+
+bool RateLimiter::allow(const string &key, chrono::steady_clock::time_point now) {
+  auto &shard = shards[hash<string>()(key) % NumShards];
+  lock_guard<std::mutex> guard(shard.mutex);
+
+  auto it = shard.buckets.find(key);
+  if (it == shard.buckets.end()) {
+    if (shard.buckets.size() >= max_per_shard) {
+      shard.buckets.erase(shard.lru.back());
+      shard.lru.pop_back();
+    }
+
+    shard.lru.push_front(key);
+    it = shard.buckets.emplace(key, Bucket({burst_, now, shard.lru.begin()})).first;
+  } else {
+    auto &bucket = it->second;
+    double elapsed = chrono::duration<double>(now-bucket.updated).count();
+    if (elapsed > 0) {
+      bucket.tokens = min(burst_, bucket.tokens + elapsed*rate_);
+      bucket.updated = now;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, bucket.lru);
+  }
+
+  if (it->second.tokens < 1) return false;
+  it->second.tokens -= 1;
+  return true;
+}
+
+size_t RateLimiter::size() {
+  size_t ret = 0;
+  for (auto &shard : shards) {
+    lock_guard<std::mutex> guard(shard.mutex);
+    ret += shard.buckets.size();
+  }
+  return ret;
+}
@@ -1,4 +1,11 @@
+#include <chrono>
 #include <filesystem>
+#include <cstdint>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
 
 #include "server.hpp"
 #include "controller_factory.hpp"
@@ -7,13 +14,17 @@
 #include "utilities.hpp"
 #include "pistache_logger.hpp"
 #include "mime_types.hpp"
+#include "http_header.hpp"
 
 using namespace std;
 using namespace Pistache;
 using namespace prails::utilities;
 
 Server::Server(ConfigParser &config) : 
-http_endpoint(make_shared<Http::Endpoint>(Address(config.address(), config.port()))) { 
+http_endpoint(make_shared<Http::Endpoint>(Address(config.address(), config.port()))),
+static_index(config.static_resource_path(), 
+  [this](const string &local_path) { return PathToMediaType(local_path); }),
+static_cache(config.static_cache_size(), config.static_cache_max_file_size()) { 
   logger = config.setup_logger("server");
   html_error500 = config.html_error(500);
   html_error404 = config.html_error(404);
@@ -22,6 +33,84 @@ http_endpoint(make_shared<Http::Endpoint>(Address(config.address(), config.port(
   this->path_views = config.views_path();
   this->threads = config.threads();
   this->max_request_size = config.max_request_size();
+  this->is_static_gzip = config.static_gzip();
+  this->path_metrics = config.metrics_path();
+  this->reactor_cpus = CpuSet(config.reactor_cpus());
+  this->is_pinning_reactors = config.pin_reactors();
+
+  // The background threads that we start below, are started from inBackground().
+  // (The log writer pins itself, when the config starts it.) Threads that we 
+  // didn't start, we leave be:
+  this->background_cpus = CpuSet(config.background_cpus());
+  if (!background_cpus.empty())
+    logger->info("Pinning background threads to cpus {}", 
+      background_cpus.to_string());
+
+  static_hits = &Metrics::GetCounter("prails_static_requests_total{result=\"hit\"}",
+    "Requests for static resources, by whether they were served from the cache.");
+  static_misses = &Metrics::GetCounter("prails_static_requests_total{result=\"miss\"}",
+    "Requests for static resources, by whether they were served from the cache.");
+  static_not_found = &Metrics::GetCounter(
+    "prails_static_requests_total{result=\"not_found\"}",
+    "Requests for static resources, by whether they were served from the cache.");
+
+  asset_manifest = make_shared<AssetManifest>(path_static);
+  if (path_is_readable(config.asset_manifest())) {
+    try {
+      asset_manifest->load(config.asset_manifest());
+      logger->info("Loaded {} fingerprinted assets from {}", asset_manifest->size(), 
+        config.asset_manifest());
+    } catch (const exception &e) {
+      logger->warn("Unable to load the asset manifest {}: {}", config.asset_manifest(),
+        e.what());
+    }
+  }
+  Controller::GetAssetManifest(asset_manifest);
+
+  if (config.static_reader() != "blocking") {
+    inBackground([&]() {
+      static_reader = StaticReader::Create(config.static_reader(), 
+        config.static_reader_threads());
+    });
+
+    if (static_reader->name() != config.static_reader())
+      logger->warn("The {} static reader is unavailable, falling back to {}",
+        config.static_reader(), static_reader->name());
+  }
+
+  // This needs to be set before the controllers bind their actions:
+  if (config.worker_threads() > 0) {
+    workers = make_shared<WorkerPool>(config.worker_threads(), 
+      CpuSet(config.worker_cpus()));
+    Controller::GetWorkerPool(workers);
+
+    Metrics::SetGauge("prails_worker_queue_depth", 
+      "Actions waiting on a worker thread.", 
+      [workers = workers]() { return workers->pending(); });
+  }
+
+  if (config.max_in_flight() > 0) {
+    admission = make_shared<AdmissionControl>(config.max_in_flight(), 
+      config.admission_queue_size(), 
+      chrono::milliseconds(config.admission_queue_timeout_ms()));
+    Controller::GetAdmissionControl(admission);
+
+    Metrics::SetGauge("prails_requests_in_flight", 
+      "Requests admitted, and not yet responded to.",
+      [admission = admission]() { return admission->in_flight(); });
+    Metrics::SetGauge("prails_requests_waiting", 
+      "Requests queued for admission.",
+      [admission = admission]() { return admission->waiting(); });
+  }
+
+  if (config.fragment_cache_size() > 0) {
+    fragments = make_shared<FragmentCache>(config.fragment_cache_size());
+    Controller::GetFragmentCache(fragments);
+
+    Metrics::SetGauge("prails_fragment_cache_bytes", 
+      "The size of the rendered fragments, in the fragment cache.",
+      [fragments = fragments]() { return fragments->bytes(); });
+  }
 
   for (const auto &reg : ModelFactory::getModelNames())
     logger->trace("Found model \"{}\"", reg);
@@ -35,25 +124,100 @@ http_endpoint(make_shared<Http::Endpoint>(Address(config.address(), config.port(
   auto opts = Http::Endpoint::options()
     .threads(threads)
     .maxRequestSize(max_request_size)
-    .flags(Tcp::Options::ReuseAddr)
+    // Preforked workers all bind the same port, and the kernel spreads the
+    // connections between them:
+    .flags((config.workers() > 1) ? (Tcp::Options::ReuseAddr | Tcp::Options::ReusePort) :
+      Flags<Tcp::Options>(Tcp::Options::ReuseAddr))
     .logger(make_shared<StringToSpdLogger>(logger));
 
   http_endpoint->init(opts);
   setupRoutes();
+  inBackground([&]() {
+    setupStatic();
+    setupViews(config.view_cache());
+  });
+}
+
+// Threads inherit the affinity of the thread that creates them. So, start is 
+// run while we're pinned to the background cpus, and whatever threads it starts
+// stay there. We then return to our own cpus:
+void Server::inBackground(const function<void()> &start) {
+  if (background_cpus.empty()) {
+    start();
+    return;
+  }
+
+  auto original_cpus = CpuSet::OfThread();
+  background_cpus.pin();
+  try {
+    start();
+  } catch (...) {
+    original_cpus.pin();
+    throw;
+  }
+  original_cpus.pin();
 }
 
 void Server::start() {
-  http_endpoint->setHandler(router.handler());
+  if (!reactor_cpus.empty()) reactor_cpus.pin();
+  http_endpoint->setHandler(handler());
   http_endpoint->serve();
 }
 
 void Server::startThreaded() {
-  http_endpoint->setHandler(router.handler());
+  http_endpoint->setHandler(handler());
+
+  if (reactor_cpus.empty()) {
+    http_endpoint->serveThreaded();
+    return;
+  }
+
+  // The acceptor, and the reactors it starts, inherit our affinity:
+  auto original_cpus = CpuSet::OfThread();
+  reactor_cpus.pin();
   http_endpoint->serveThreaded();
+  original_cpus.pin();
+}
+
+shared_ptr<Http::Handler> Server::handler() {
+  if (!is_pinning_reactors) return router.handler();
+  return make_shared<ReactorPinningHandler>(router, reactor_cpus, logger);
+}
+
+// Pistache doesn't expose its reactor threads. But, every request is handled on
+// one. So, each reactor pins itself to the next cpu in the set, as it handles 
+// its first request. (The acceptor, which does very little, stays on the set):
+Server::ReactorPinningHandler::ReactorPinningHandler(Rest::Router &router, 
+  const CpuSet &cpus, shared_ptr<spdlog::logger> logger) : router(&router), 
+  cpus(cpus), logger(logger), next_cpu(make_shared<atomic<size_t>>(0)) {}
+
+void Server::ReactorPinningHandler::onRequest(const Http::Request &request, 
+  Http::ResponseWriter response) {
+  thread_local bool is_pinned = false;
+
+  if (!is_pinned) {
+    is_pinned = true;
+    auto cpu = cpus.at(next_cpu->fetch_add(1));
+    try {
+      cpu.pin();
+      logger->debug("Pinned a reactor thread to cpu {}", cpu.to_string());
+    } catch (const exception &e) {
+      logger->warn("Unable to pin a reactor thread: {}", e.what());
+    }
+  }
+
+  router->route(request, move(response));
 }
 
+// The port that we're listening on. Which, if we were configured with a port 
+// of 0, was chosen by the kernel when we started:
+unsigned int Server::port() { return http_endpoint->getPort(); }
+
 void Server::shutdown() { 
   http_endpoint->shutdown(); 
+  if (workers) workers->shutdown();
+  if (static_watcher) static_watcher->stop();
+  if (views_watcher) views_watcher->stop();
 }
 
 void Server::setupRoutes() {
@@ -62,58 +226,573 @@ void Server::setupRoutes() {
   for (auto &[reg, controller] : controllers)
     ControllerFactory::setRoutes(reg, router, controller);
 
+  if (!path_metrics.empty())
+    Routes::Get(router, path_metrics, Routes::bind(&Server::doMetrics, this));
+
   Routes::NotFound(router, Routes::bind(&Server::doNotFound, this));
 }
 
-void Server::doNotFound(const Rest::Request& request, Http::ResponseWriter response) {
-  auto valid_path = regex("^[0-9 a-z\\-\\_\\.\\/]+$", regex_constants::icase);
+void Server::setupStatic() {
+  auto started = chrono::steady_clock::now();
+  static_index.rebuild();
+
+  logger->info("Indexed {} static resources in {}ms", static_index.size(),
+    chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now()-started).count());
+
+  try {
+    static_watcher = make_unique<FileWatcher>(path_static);
+    // An asset that changed no longer matches its fingerprint:
+    static_watcher->subscribe([this](const string &path) {
+      asset_manifest->invalidate(path);
+    });
+
+    static_watcher->subscribe([this](const string &path) {
+      auto changed = chrono::steady_clock::now();
+      static_index.update(path);
+      logger->debug("Static resource changed: {}. Re-indexed {} static resources "
+        "in {}us", path, static_index.size(), 
+        chrono::duration_cast<chrono::microseconds>(
+          chrono::steady_clock::now()-changed).count());
+    });
+
+    // Without change notifications, we'd have no way of knowing when a cached 
+    // file went stale. So, we only cache when we can watch.
+    if (static_cache.is_enabled())
+      static_watcher->subscribe([this](const string &path) {
+        static_cache.invalidate(path);
+      });
+
+    static_watcher->start();
+  } catch (const exception &e) {
+    logger->warn("Static resources will not be re-indexed, and the static cache "
+      "is disabled. Unable to watch {}: {}", path_static, e.what());
+    static_watcher.reset();
+    static_cache.disable();
+
+    // Nor would we know when an asset stopped matching its fingerprint. Rather 
+    // than tell clients to cache a stale asset forever, we serve them all under 
+    // their plain resources:
+    if (asset_manifest->size() > 0) {
+      logger->warn("Fingerprinted assets are disabled, as {} can't be watched", 
+        path_static);
+      asset_manifest->invalidate(path_static);
+    }
+  }
+}
+
+void Server::setupViews(const string &view_cache) {
+  // In production, views are never re-read. So, neither are their includes:
+  if (view_cache == "production") {
+    includes = make_shared<IncludeStore>();
+    Controller::GetIncludeStore(includes);
+    return;
+  }
 
+  // Otherwise, as with the static cache, we only cache includes when we can 
+  // watch them for changes:
+  try {
+    views_watcher = make_unique<FileWatcher>(path_views);
+    auto store = make_shared<IncludeStore>();
+    views_watcher->subscribe([store](const string &path) { 
+      store->invalidate(path); 
+    });
+    views_watcher->start();
+
+    includes = store;
+    Controller::GetIncludeStore(includes);
+  } catch (const exception &e) {
+    logger->warn("Views will be re-read on every include_as_string(). Unable to "
+      "watch {}: {}", path_views, e.what());
+    views_watcher.reset();
+  }
+}
+
+void Server::doNotFound(const Rest::Request& request, Http::ResponseWriter response) {
   string resource = request.resource();
 
-  if (!path_is_readable(this->path_static)) {
-    logger->error("Static Resource path unreadable upon request: {}", resource);
+  // Fingerprinted assets are served from the file that they fingerprint:
+  if (auto fingerprinted = asset_manifest->resource_for(resource); fingerprinted)
+    resource = *fingerprinted;
+
+  auto indexed = static_index.find(resource);
+  if (!indexed) {
+    static_not_found->increment();
+    logger->error("Resource Not Found: {}", resource);
     response.send(Http::Code::Not_Found, html_error404, MIME(Text, Html));
+    return;
+  }
+
+  auto entry = static_cache.find(resource);
+  if (entry)
+    static_hits->increment();
+  else {
+    static_misses->increment();
+    auto sidecar = static_index.find(resource+".gz");
+    auto gzip_path = (sidecar) ? make_optional<string>(sidecar->local_path) : nullopt;
+    bool is_compressible = is_static_gzip && IsCompressible(indexed->mime_type);
+
+    if (static_reader) {
+      readStatic(request, std::move(response), resource, indexed, gzip_path, 
+        is_compressible);
+      return;
+    }
+
+    entry = static_cache.load(resource, indexed->local_path, indexed->mime_type, 
+      gzip_path, is_compressible);
+  }
+
+  if (entry) {
+    logger->info("Serving: {}", resource);
+    sendStatic(request, std::move(response), entry);
   } else {
-    string local_path = filesystem::weakly_canonical(path_static+resource);
-    
-    // To Ensure they didn't ../ their way out of public. We test that the begining
-    // of local_path matches path_static, and that the path's characters are sane.
-    if (!starts_with(local_path,path_static) || (!regex_match(local_path, valid_path))) {
-      logger->error("Resource Denied: {}", resource);
-      response.send(Http::Code::Internal_Server_Error, html_error500, MIME(Text, Html));
-    } else if ((!path_is_readable(local_path)) || (!filesystem::is_regular_file(local_path))) {
-      logger->error("Resource Unreadable: {}", resource);
-      response.send(Http::Code::Not_Found, html_error404, MIME(Text, Html));
-    } else if (local_path != string(filesystem::canonical(local_path))) {
-      // This should prevent us from following filesystem links. Note that 
-      // canonical requires the path to exist, unlike weakly_canonical.
-      logger->error("Resource Path Denied: {}", resource);
-      response.send(Http::Code::Internal_Server_Error, html_error500, MIME(Text, Html));
+    logger->error("Resource Unreadable: {}", resource);
+    response.send(Http::Code::Not_Found, html_error404, MIME(Text, Html));
+  }
+}
+
+void Server::doMetrics(const Rest::Request&, Http::ResponseWriter response) {
+  response.send(Http::Code::Ok, Metrics::Scrape(), 
+    Http::Mime::MediaType::fromString("text/plain; version=0.0.4"));
+}
+
+// Cache misses, when we have a StaticReader, are read off of the reactor thread,
+// and the response is sent from whichever thread the read completed on:
+void Server::readStatic(const Rest::Request& request, Http::ResponseWriter response,
+  const string &resource, StaticIndex::EntryPtr indexed, 
+  const optional<string> &gzip_path, bool is_compressible) {
+  auto pending = static_cache.prepare(resource, indexed->local_path, 
+    indexed->mime_type, gzip_path, is_compressible);
+
+  // Files too large to be resident are sent by pistache, and there's nothing for
+  // us to read:
+  if (pending && !pending->entry->is_resident) {
+    logger->info("Serving: {}", resource);
+    sendStatic(request, std::move(response), static_cache.complete(*pending));
+    return;
+  }
+
+  if (!pending) {
+    logger->error("Resource Unreadable: {}", resource);
+    response.send(Http::Code::Not_Found, html_error404, MIME(Text, Html));
+    return;
+  }
+
+  // The request and response need to outlive this handler. ResponseWriter is
+  // move-only, and std::function wants something copyable, hence the shared_ptr:
+  auto state = make_shared<pair<Rest::Request, Http::ResponseWriter>>(
+    request, std::move(response));
+
+  auto finish = [this, state, pending = *pending](optional<string> content,
+    optional<string> gzip_content) {
+    auto &[request, response] = *state;
+    auto entry = (content) ? 
+      static_cache.complete(pending, std::move(*content), std::move(gzip_content)) :
+      nullptr;
+
+    if (entry) {
+      logger->info("Serving: {}", entry->resource);
+      sendStatic(request, std::move(response), entry);
     } else {
-      logger->info("Serving: {}", resource);
-
-      smatch matches;
-      Http::Mime::MediaType mime_type;
-      string res_ext;
-
-      if (regex_search(local_path, matches, regex("([^.]+)$")))
-        res_ext = matches[1];
-
-      if (ExtToMime(res_ext).has_value()) {
-        try {
-          // Unfortunately, pistache has a very limited number of mime types that it
-          // includes classes for. But, catch seems seems to work:
-          mime_type = Http::Mime::MediaType::fromString(*ExtToMime(res_ext));
-        } catch(const Http::HttpError& e) {
-          logger->warn("Serving */* for the resource: {}", resource);
-          mime_type = MIME(Star, Star);
+      logger->error("Resource Unreadable: {}", pending.entry->resource);
+      response.send(Http::Code::Not_Found, html_error404, MIME(Text, Html));
+    }
+  };
+
+  static_reader->read(indexed->local_path, [this, gzip_path, finish](
+    optional<string> content) {
+    if (!content || !gzip_path) return finish(std::move(content), nullopt);
+
+    // There's a sidecar to read as well:
+    static_reader->read(*gzip_path, [finish, content = std::move(content)](
+      optional<string> gzip_content) mutable {
+      finish(std::move(content), std::move(gzip_content));
+    });
+  });
+}
+
+void Server::sendStatic(const Rest::Request& request, Http::ResponseWriter response, 
+  StaticCache::EntryPtr entry) {
+  bool is_head = (request.method() == Http::Method::Head);
+  auto range = RequestHeader(request, "Range");
+
+  // Ranges are only offered on the identity encoding, and only when the client
+  // still holds the representation that it's asking for a piece of:
+  if (range) {
+    auto if_range = RequestHeader(request, "If-Range");
+    if (if_range && (*if_range != entry->etag) && (*if_range != entry->last_modified))
+      range = nullopt;
+  }
+
+  bool is_gzip = !range && entry->has_gzip() && 
+    AcceptsGzip(RequestHeader(request, "Accept-Encoding"));
+
+  response.headers()
+    .add(make_shared<prails::HttpHeader>("ETag", 
+      (is_gzip) ? entry->gzip_etag : entry->etag))
+    .add(make_shared<prails::HttpHeader>("Last-Modified", entry->last_modified))
+    .add(make_shared<prails::HttpHeader>("Accept-Ranges", "bytes"));
+
+  // Entries are keyed by the resource we resolved the request to. So, these only
+  // differ for fingerprinted urls, which change whenever their content does.
+  // There's never a reason for a client to revalidate those:
+  if (request.resource() != entry->resource)
+    response.headers().add(make_shared<prails::HttpHeader>("Cache-Control", 
+      "public, max-age=31536000, immutable"));
+
+  // Caches between us and the client need to know that there's more than one
+  // representation of this resource:
+  if (entry->has_gzip())
+    response.headers().add(make_shared<prails::HttpHeader>("Vary", "Accept-Encoding"));
+
+  if (entry->is_not_modified(RequestHeader(request, "If-None-Match"), 
+    RequestHeader(request, "If-Modified-Since"))) {
+    response.send(Http::Code::Not_Modified);
+    return;
+  }
+
+  if (range)
+    if (auto ranges = ParseRanges(*range, entry->size); ranges) {
+      sendRanges(std::move(response), entry, *ranges, is_head);
+      return;
+    }
+
+  if (is_gzip)
+    response.headers().add(make_shared<prails::HttpHeader>("Content-Encoding", "gzip"));
+
+  if (is_head) {
+    size_t content_length = entry->size;
+    if (is_gzip)
+      content_length = (entry->is_resident) ? entry->gzip_content.size() : 
+        FileSize(entry->gzip_path);
+    sendHead(std::move(response), Http::Code::Ok, content_length, entry->mime_type);
+  } else if (entry->is_resident)
+    response.send(Http::Code::Ok, (is_gzip) ? entry->gzip_content : entry->content, 
+      entry->mime_type);
+  else
+    // This is pistache's sendfile() path, which never copies into userspace:
+    Http::serveFile(response, (is_gzip) ? entry->gzip_path : entry->local_path, 
+      entry->mime_type);
+}
+
+// The pieces of a range response, written to the peer a slice at a time. The
+// next slice is only read once pistache has written the last one. So, however
+// much a request asks for, we never hold more than a slice of it. Pieces that
+// are read from the file are pread() as they're needed, which (unlike a mapping)
+// fails gracefully, should the file be truncated underneath us:
+class RangeWriter : public enable_shared_from_this<RangeWriter> {
+  public:
+    struct Piece {
+      string text;
+      size_t offset = 0;
+      size_t length = 0;
+    };
+
+    RangeWriter(shared_ptr<Tcp::Peer> peer, StaticCache::EntryPtr entry, int fd, 
+      vector<Piece> pieces) : peer(peer), entry(entry), fd(fd), 
+      pieces(std::move(pieces)) {}
+
+    ~RangeWriter() { if (fd >= 0) close(fd); }
+
+    void next() {
+      if (piece == pieces.size()) return;
+
+      auto &current = pieces[piece];
+      string buffer;
+
+      if (current.length == 0) {
+        buffer = std::move(current.text);
+        piece++;
+      } else {
+        buffer.resize(min(Server::StreamSliceLength, current.length));
+        if (!read(buffer, current.offset)) {
+          // We've promised a Content-Length that we can no longer honor. All 
+          // that's left, is to tell the client that by hanging up:
+          shutdown(peer->fd(), SHUT_RDWR);
+          return;
         }
+
+        current.offset += buffer.size();
+        current.length -= buffer.size();
+        if (current.length == 0) piece++;
+      }
+
+      auto self = shared_from_this();
+      size_t length = buffer.size();
+      peer->send(RawBuffer(std::move(buffer), length)).then(
+        [self](ssize_t) { self->next(); }, Async::IgnoreException);
+    }
+
+  private:
+    shared_ptr<Tcp::Peer> peer;
+    StaticCache::EntryPtr entry;
+    int fd;
+    vector<Piece> pieces;
+    size_t piece = 0;
+
+    bool read(string &buffer, size_t offset) {
+      if (entry->is_resident) {
+        entry->content.copy(buffer.data(), buffer.size(), offset);
+        return true;
+      }
+
+      for (size_t done = 0; done < buffer.size(); ) {
+        ssize_t ret = pread(fd, buffer.data()+done, buffer.size()-done, offset+done);
+        if ((ret < 0) && (errno == EINTR)) continue;
+        if (ret <= 0) return false;
+        done += ret;
+      }
+      return true;
+    }
+};
+
+void Server::sendRanges(Http::ResponseWriter response, StaticCache::EntryPtr entry,
+  const vector<pair<size_t, size_t>> &ranges, bool is_head) {
+
+  if (ranges.empty()) {
+    response.headers().add(make_shared<prails::HttpHeader>("Content-Range", 
+      fmt::format("bytes */{}", entry->size)));
+    response.send(Http::Code::Requested_Range_Not_Satisfiable);
+    return;
+  }
+
+  // Pistache only offers sendfile() for entire files. Pieces of the files that 
+  // we don't hold in memory, are read from the file as they're written:
+  int fd = -1;
+  if (!entry->is_resident && !is_head) {
+    struct stat st;
+    fd = open(entry->local_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) || (fstat(fd, &st) != 0) || 
+      (static_cast<size_t>(st.st_size) != entry->size)) {
+      if (fd >= 0) close(fd);
+      logger->error("Unable to read resource: {}", entry->resource);
+      response.send(Http::Code::Internal_Server_Error, html_error500, MIME(Text, Html));
+      return;
+    }
+  }
+
+  vector<RangeWriter::Piece> pieces;
+  size_t content_length = 0;
+  optional<Http::Mime::MediaType> mime_type;
+
+  if (ranges.size() == 1) {
+    auto [first, last] = ranges[0];
+    response.headers().add(make_shared<prails::HttpHeader>("Content-Range", 
+      fmt::format("bytes {}-{}/{}", first, last, entry->size)));
+
+    pieces.push_back({"", first, last-first+1});
+    content_length = last-first+1;
+    mime_type = entry->mime_type;
+  } else {
+    // Multiple ranges are sent as a multipart/byteranges body. (RFC 7233, 
+    // Appendix A)
+    const string boundary = fmt::format("prails-{:x}", 
+      chrono::steady_clock::now().time_since_epoch().count());
+
+    response.headers().add(make_shared<prails::HttpHeader>("Content-Type", 
+      "multipart/byteranges; boundary="+boundary));
+
+    for (const auto &[first, last] : ranges) {
+      pieces.push_back({fmt::format("{}--{}\r\nContent-Type: {}\r\n"
+        "Content-Range: bytes {}-{}/{}\r\n\r\n", (pieces.empty()) ? "" : "\r\n",
+        boundary, entry->mime_type.toString(), first, last, entry->size)});
+      pieces.push_back({"", first, last-first+1});
+    }
+    pieces.push_back({"\r\n--"+boundary+"--\r\n"});
+
+    for (const auto &piece : pieces) 
+      content_length += (piece.length) ? piece.length : piece.text.size();
+  }
+
+  string head = ResponseHead(response, Http::Code::Partial_Content, content_length,
+    mime_type);
+
+  if (is_head) {
+    response.peer()->send(RawBuffer(head, head.size()));
+    return;
+  }
+
+  pieces.insert(pieces.begin(), RangeWriter::Piece{head});
+  make_shared<RangeWriter>(response.peer(), entry, fd, std::move(pieces))->next();
+}
+
+// Pistache writes the Content-Length of whatever body it's handed, which is 
+// zero for a HEAD. Since a HEAD is supposed to report the length of the body that
+// a GET would have sent, we write the response head ourselves:
+void Server::sendHead(Http::ResponseWriter response, Http::Code code, 
+  size_t content_length, const optional<Http::Mime::MediaType> &mime_type) {
+  string head = ResponseHead(response, code, content_length, mime_type);
+  response.peer()->send(RawBuffer(head, head.size()));
+}
+
+// The status line and headers of a response that we write to the peer ourselves,
+// rather than through the ResponseWriter:
+string Server::ResponseHead(Http::ResponseWriter &response, Http::Code code, 
+  size_t content_length, const optional<Http::Mime::MediaType> &mime_type) {
+  stringstream head;
+  head << "HTTP/1.1 " << static_cast<int>(code) << " " << Http::codeString(code) 
+    << "\r\n";
+
+  for (const auto &header : response.headers().list()) {
+    head << header->name() << ": ";
+    header->write(head);
+    head << "\r\n";
+  }
+
+  if (mime_type)
+    head << "Content-Type: " << mime_type->toString() << "\r\n";
+  head << "Content-Length: " << content_length << "\r\n\r\n";
+
+  return head.str();
+}
+
+size_t Server::FileSize(const string &path) {
+  error_code error;
+  auto ret = filesystem::file_size(path, error);
+  return (error) ? 0 : ret;
+}
+
+optional<vector<pair<size_t, size_t>>> Server::ParseRanges(const string &range, 
+  size_t size) {
+  const auto is_digits = [](const string &s) {
+    return all_of(s.begin(), s.end(), ::isdigit);
+  };
+
+  if (!starts_with(range, "bytes=")) return nullopt;
+
+  auto specs = split(range.substr(6), ",");
+  if (specs.empty()) return nullopt;
+
+  vector<pair<size_t, size_t>> ret;
+
+  try {
+    for (auto spec : specs) {
+      spec.erase(remove_if(spec.begin(), spec.end(), ::isspace), spec.end());
+
+      auto dash = spec.find('-');
+      if (dash == string::npos) return nullopt;
+
+      string first = spec.substr(0, dash);
+      string last = spec.substr(dash+1);
+
+      if ((first.empty() && last.empty()) || !is_digits(first) || !is_digits(last))
+        return nullopt;
+
+      if (first.empty()) {
+        // This is a suffix range, ie "the last N bytes":
+        size_t suffix = stoull(last);
+        if ((suffix > 0) && (size > 0))
+          ret.push_back({size-min(suffix, size), size-1});
       } else {
-        logger->warn("Unable to find a content type for the resource: {}", resource);
-        mime_type = MIME(Text, Plain);
+        size_t first_byte = stoull(first);
+        size_t last_byte = (last.empty()) ? SIZE_MAX : stoull(last);
+
+        if (last_byte < first_byte) return nullopt;
+
+        // Unsatisfiable ranges are skipped. If they all are, we'll 416:
+        if (first_byte < size)
+          ret.push_back({first_byte, min(last_byte, size-1)});
       }
-      Http::serveFile(response, local_path, mime_type);
+
+      if (ret.size() > MaxRanges) return nullopt;
+    }
+  } catch (const out_of_range &) {
+    return nullopt;
+  }
+
+  // Overlapping (and adjacent) ranges are sent once, as a single range. Since the
+  // coalesced ranges never overlap, what we send is never more than the file:
+  sort(ret.begin(), ret.end());
+
+  vector<pair<size_t, size_t>> coalesced;
+  for (const auto &range : ret) {
+    if (coalesced.empty() || (range.first > coalesced.back().second+1)) {
+      coalesced.push_back(range);
+      continue;
     }
+
+    coalesced.back().second = max(coalesced.back().second, range.second);
+  }
+
+  return coalesced;
+}
+
+optional<string> Server::RequestHeader(const Rest::Request &request, 
+  const string &name) {
+  // Headers that pistache doesn't have a class for, are only available raw:
+  try {
+    return request.headers().getRaw(name).value();
+  } catch (const runtime_error &) { }
+
+  if (auto header = request.headers().tryGet(name); header) {
+    stringstream value;
+    header->write(value);
+    return value.str();
+  }
+
+  return nullopt;
+}
+
+bool Server::IsCompressible(const Http::Mime::MediaType &mime_type) {
+  string mime = mime_type.toString();
+
+  // We only want the type, and not any parameters that may follow it:
+  mime = mime.substr(0, mime.find(';'));
+  transform(mime.begin(), mime.end(), mime.begin(), ::tolower); 
+
+  for (const auto &prefix : _compressible_mime_type_prefixes)
+    if (mime.compare(0, prefix.size(), prefix) == 0) return true;
+
+  for (const auto &suffix : _compressible_mime_type_suffixes)
+    if ((mime.size() >= suffix.size()) && 
+      (mime.compare(mime.size()-suffix.size(), suffix.size(), suffix) == 0))
+      return true;
+
+  return false;
+}
+
+bool Server::AcceptsGzip(const optional<string> &accept_encoding) {
+  if (!accept_encoding) return false;
+
+  for (auto coding : split(*accept_encoding, ",")) {
+    // Strip the whitespace, and lowercase:
+    coding.erase(remove_if(coding.begin(), coding.end(), ::isspace), coding.end());
+    transform(coding.begin(), coding.end(), coding.begin(), ::tolower); 
+
+    auto parameters = split(coding, ";");
+    if (parameters.empty() || ((parameters[0] != "gzip") && (parameters[0] != "*")))
+      continue;
+
+    // A q of zero, means "not acceptable":
+    bool is_refused = false;
+    for (auto it = parameters.begin()+1; it != parameters.end(); it++)
+      if (starts_with(*it, "q=") && (atof(it->substr(2).c_str()) == 0))
+        is_refused = true;
+
+    if (!is_refused) return true;
+  }
+
+  return false;
+}
+
+Http::Mime::MediaType Server::PathToMediaType(const string &local_path) {
+  string ext = filesystem::path(local_path).extension().string();
+  if (!ext.empty()) ext.erase(0, 1);
+
+  auto mime = ExtToMime(ext);
+
+  if (!mime) {
+    logger->warn("Unable to find a content type for the resource: {}", local_path);
+    return MIME(Text, Plain);
+  }
+
+  try {
+    // Unfortunately, pistache has a very limited number of mime types that it
+    // includes classes for. But, catch seems seems to work:
+    return Http::Mime::MediaType::fromString(*mime);
+  } catch(const Http::HttpError& e) {
+    logger->warn("Serving */* for the resource: {}", local_path);
+    return MIME(Star, Star);
   }
 }
 
@@ -121,14 +800,18 @@ optional<string> Server::ExtToMime(const string &ext) {
   string ext_lower = ext;
   transform(ext_lower.begin(), ext_lower.end(), ext_lower.begin(), ::tolower); 
 
-  static map<string, string> _extension_to_mime;
-  if (_extension_to_mime.size() == 0)
+  // Function-local statics are initialized exactly once, even when we're 
+  // called concurrently from several reactor threads:
+  static const unordered_map<string, string> extension_to_mime = [] {
+    unordered_map<string, string> ret;
     for (unsigned int i = 1; i < size(_default_mime_types); i+=2) {
       string key = {_default_mime_types[i-1].data(), _default_mime_types[i-1].size()};
       string val = {_default_mime_types[i].data(), _default_mime_types[i].size()};
-      _extension_to_mime[key] = val;
+      ret[key] = val;
     }
+    return ret;
+  }();
 
-  return (_extension_to_mime.count(ext_lower)) ?
-    make_optional<string>(_extension_to_mime[ext_lower]) : nullopt;
+  auto it = extension_to_mime.find(ext_lower);
+  return (it != extension_to_mime.end()) ? make_optional<string>(it->second) : nullopt;
 }
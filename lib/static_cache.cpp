@@ -0,0 +1,236 @@
+#include <sys/stat.h>
+#include <zlib.h>
+#include <cstring>
+#include <filesystem>
+
+#include "spdlog/spdlog.h"
+
+#include "static_cache.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+bool StaticCache::Entry::is_not_modified(const optional<string> &if_none_match,
+  const optional<string> &if_modified_since) const {
+
+  // If-None-Match takes precedence over If-Modified-Since, when both are present.
+  // (See RFC 7232, Section 6)
+  if (if_none_match) {
+    if (*if_none_match == "*") return true;
+    for (auto tag : split(*if_none_match, ",")) {
+      tag.erase(0, tag.find_first_not_of(" \t"));
+      tag.erase(tag.find_last_not_of(" \t")+1);
+      // Weak comparison is all that's needed for a GET:
+      if (starts_with(tag, "W/")) tag.erase(0, 2);
+      if ((tag == etag) || (has_gzip() && (tag == gzip_etag))) return true;
+    }
+    return false;
+  }
+
+  if (if_modified_since)
+    if (auto since = http_date_to_time(*if_modified_since); since)
+      return (mtime <= *since);
+
+  return false;
+}
+
+StaticCache::EntryPtr StaticCache::find(const string &resource) {
+  lock_guard<std::mutex> guard(mutex);
+
+  auto it = entries.find(resource);
+  if (it == entries.end()) return nullptr;
+
+  lru.splice(lru.begin(), lru, it->second);
+  return *it->second;
+}
+
+StaticCache::EntryPtr StaticCache::load(const string &resource,
+  const string &local_path, const Pistache::Http::Mime::MediaType &mime_type,
+  const optional<string> &gzip_path, bool is_compressible) {
+
+  auto pending = prepare(resource, local_path, mime_type, gzip_path, is_compressible);
+  if (!pending) return nullptr;
+
+  if (!pending->entry->is_resident) return complete(*pending);
+
+  return complete(*pending, read_file(local_path), 
+    (gzip_path) ? make_optional(read_file(*gzip_path)) : nullopt);
+}
+
+optional<StaticCache::Pending> StaticCache::prepare(const string &resource,
+  const string &local_path, const Pistache::Http::Mime::MediaType &mime_type,
+  const optional<string> &gzip_path, bool is_compressible) {
+
+  Pending ret;
+  ret.gzip_path = gzip_path;
+  ret.is_compressible = is_compressible;
+
+  // Any invalidation that arrives while we're reading the file, means that what
+  // we read may be stale. In that case, we serve what we read, but don't cache it.
+  {
+    lock_guard<std::mutex> guard(mutex);
+    ret.generation = generation;
+  }
+
+  struct stat st;
+  if (stat(local_path.c_str(), &st) != 0) return nullopt;
+
+  ret.entry = make_shared<Entry>();
+  ret.entry->resource = resource;
+  ret.entry->local_path = local_path;
+  ret.entry->size = st.st_size;
+  ret.entry->mtime = st.st_mtim.tv_sec;
+  ret.entry->etag = fmt::format("\"{:x}-{:x}.{:x}\"", st.st_size, st.st_mtim.tv_sec,
+    st.st_mtim.tv_nsec);
+  ret.entry->last_modified = time_to_http_date(st.st_mtim.tv_sec);
+  ret.entry->mime_type = mime_type;
+  ret.entry->is_resident = (static_cast<size_t>(st.st_size) <= max_file_bytes);
+
+  return ret;
+}
+
+// The content (and gzip_content) supplied here, are only expected for resident
+// entries. And, gzip_content only when a sidecar path was prepared:
+StaticCache::EntryPtr StaticCache::complete(const Pending &pending, string content,
+  optional<string> gzip_content) {
+
+  // We copy the entry, so that a Pending can be completed more than once:
+  auto entry = make_shared<Entry>(*pending.entry);
+
+  if (entry->is_resident) {
+    // The file changed out from under us:
+    if (content.size() != entry->size) return nullptr;
+    entry->content = std::move(content);
+  }
+
+  // A precompressed sidecar always wins over compressing it ourselves:
+  if (pending.gzip_path) {
+    if (entry->is_resident)
+      entry->gzip_content = (gzip_content) ? std::move(*gzip_content) : string();
+    else
+      entry->gzip_path = *pending.gzip_path;
+  } else if (pending.is_compressible && entry->is_resident && is_retainable(*entry, 
+    pending.generation)) {
+    // Compressing is only worth the cpu, if we'll be keeping the result around
+    // for the next request. And, only if it actually saves some bytes:
+    if (auto compressed = Gzip(entry->content); 
+      compressed && (compressed->size() < entry->content.size()))
+      entry->gzip_content = *compressed;
+  }
+
+  if (entry->has_gzip())
+    entry->gzip_etag = entry->etag.substr(0, entry->etag.size()-1)+"-gz\"";
+
+  lock_guard<std::mutex> guard(mutex);
+
+  if ((max_bytes == 0) || (pending.generation != generation)) return entry;
+
+  if (auto it = entries.find(entry->resource); it != entries.end()) erase(it->second);
+
+  size_t entry_bytes = EntryBytes(*entry);
+  if (entry_bytes > max_bytes) return entry;
+
+  while (!lru.empty() && (bytes_used + entry_bytes > max_bytes))
+    erase(prev(lru.end()));
+
+  lru.push_front(entry);
+  entries[entry->resource] = lru.begin();
+  bytes_used += entry_bytes;
+
+  return entry;
+}
+
+void StaticCache::invalidate(const string &local_path) {
+  lock_guard<std::mutex> guard(mutex);
+
+  generation++;
+
+  // A change to a sidecar, is a change to the file it compresses:
+  string uncompressed_path = (filesystem::path(local_path).extension() == ".gz") ?
+    local_path.substr(0, local_path.size()-3) : local_path;
+
+  // The provided path may be a file, or a directory that contains files:
+  for (auto it = lru.begin(); it != lru.end(); ) {
+    auto next_it = next(it);
+    if (((*it)->local_path == local_path) || 
+      ((*it)->local_path == uncompressed_path) ||
+      starts_with((*it)->local_path, local_path+"/"))
+      erase(it);
+    it = next_it;
+  }
+}
+
+void StaticCache::clear() {
+  lock_guard<std::mutex> guard(mutex);
+  generation++;
+  lru.clear();
+  entries.clear();
+  bytes_used = 0;
+}
+
+void StaticCache::disable() {
+  clear();
+  lock_guard<std::mutex> guard(mutex);
+  max_bytes = 0;
+}
+
+size_t StaticCache::size() {
+  lock_guard<std::mutex> guard(mutex);
+  return entries.size();
+}
+
+bool StaticCache::is_enabled() {
+  lock_guard<std::mutex> guard(mutex);
+  return max_bytes > 0;
+}
+
+size_t StaticCache::bytes() {
+  lock_guard<std::mutex> guard(mutex);
+  return bytes_used;
+}
+
+optional<string> StaticCache::Gzip(const string &content) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+
+  // A windowBits of 15+16, instructs zlib to write a gzip header and trailer.
+  // Since we only do this once per file, we may as well compress it well:
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15+16, 8, 
+    Z_DEFAULT_STRATEGY) != Z_OK)
+    return nullopt;
+
+  string ret;
+  ret.resize(deflateBound(&stream, content.size()));
+
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(content.data()));
+  stream.avail_in = content.size();
+  stream.next_out = reinterpret_cast<Bytef *>(ret.data());
+  stream.avail_out = ret.size();
+
+  int result = deflate(&stream, Z_FINISH);
+  ret.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return (result == Z_STREAM_END) ? make_optional(ret) : nullopt;
+}
+
+// Whether an entry will be inserted by complete(), were it to carry a gzip'd 
+// copy of its content. (Which we only keep when it's smaller than the content)
+bool StaticCache::is_retainable(const Entry &entry, unsigned long pending_generation) {
+  lock_guard<std::mutex> guard(mutex);
+  return (max_bytes > 0) && (pending_generation == generation) && 
+    (EntryBytes(entry) + entry.content.size() <= max_bytes);
+}
+
+size_t StaticCache::EntryBytes(const Entry &entry) {
+  return sizeof(Entry) + entry.resource.size() + entry.local_path.size() +
+    entry.content.size() + entry.etag.size() + entry.last_modified.size() +
+    entry.gzip_path.size() + entry.gzip_content.size() + entry.gzip_etag.size();
+}
+
+void StaticCache::erase(LruList::iterator it) {
+  bytes_used -= EntryBytes(**it);
+  entries.erase((*it)->resource);
+  lru.erase(it);
+}
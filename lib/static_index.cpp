@@ -0,0 +1,89 @@
+#include <regex>
+#include <filesystem>
+
+#include "static_index.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+StaticIndex::StaticIndex(const string &root, MimeResolver mime_resolver) :
+  root(root), mime_resolver(mime_resolver) {}
+
+StaticIndex::EntryPtr StaticIndex::find(const string &resource) {
+  shared_lock<shared_mutex> guard(mutex);
+  auto it = entries.find(resource);
+  return (it == entries.end()) ? nullptr : it->second;
+}
+
+size_t StaticIndex::size() {
+  shared_lock<shared_mutex> guard(mutex);
+  return entries.size();
+}
+
+void StaticIndex::rebuild() {
+  unique_lock<shared_mutex> guard(mutex);
+  entries.clear();
+  index_path(root);
+}
+
+void StaticIndex::update(const string &path) {
+  unique_lock<shared_mutex> guard(mutex);
+
+  // Whatever was there before is gone, or is about to be replaced:
+  if (path == root)
+    entries.clear();
+  else
+    erase_path(path);
+
+  index_path(path);
+}
+
+optional<string> StaticIndex::resource_for(const string &local_path) {
+  static const regex valid_path("^[0-9 a-z\\-\\_\\.\\/]+$", regex_constants::icase);
+
+  if (!starts_with(local_path, root+"/")) return nullopt;
+
+  string resource = local_path.substr(root.size());
+
+  // To ensure no one can ../ their way out of the root. These paths aren't
+  // generated by the filesystem, but, we'd rather be sure:
+  if ((!regex_match(resource, valid_path)) || (resource.find("/..") != string::npos)
+    || (resource.find("/./") != string::npos) || (resource.find("//") != string::npos))
+    return nullopt;
+
+  return resource;
+}
+
+void StaticIndex::index_path(const string &path) {
+  error_code ec;
+  auto status = filesystem::symlink_status(path, ec);
+  if (ec) return;
+
+  // This should prevent us from following filesystem links:
+  if (filesystem::is_symlink(status)) return;
+
+  if (filesystem::is_regular_file(status))
+    index_file(path);
+  else if (filesystem::is_directory(status))
+    for (const auto &entry : filesystem::directory_iterator(path, ec))
+      index_path(entry.path().string());
+}
+
+void StaticIndex::index_file(const string &local_path) {
+  auto resource = resource_for(local_path);
+  if (!resource || !path_is_readable(local_path)) return;
+
+  entries[*resource] = make_shared<const Entry>(
+    Entry({local_path, mime_resolver(local_path)}));
+}
+
+void StaticIndex::erase_path(const string &path) {
+  auto resource = resource_for(path);
+  if (!resource) return;
+
+  // The path may be a file, or a directory of files:
+  for (auto it = entries.begin(); it != entries.end(); )
+    it = ((it->first == *resource) || starts_with(it->first, *resource+"/")) ?
+      entries.erase(it) : next(it);
+}
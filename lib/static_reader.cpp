@@ -0,0 +1,332 @@
+#include <deque>
+#include <chrono>
+#include <unordered_set>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <condition_variable>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef PRAILS_WITH_LIBURING
+#include <liburing.h>
+#endif
+
+#include "static_reader.hpp"
+
+using namespace std;
+
+static optional<string> ReadFile(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullopt;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return nullopt;
+  }
+
+  string ret(st.st_size, '\0');
+  size_t offset = 0;
+  while (offset < ret.size()) {
+    ssize_t len = pread(fd, ret.data()+offset, ret.size()-offset, offset);
+    if ((len < 0) && (errno == EINTR)) continue;
+    if (len <= 0) break;
+    offset += len;
+  }
+  close(fd);
+
+  return (offset == ret.size()) ? make_optional(ret) : nullopt;
+}
+
+// The fallback. Reads block, but they block one of our threads, rather than a
+// reactor thread:
+class ThreadedStaticReader : public StaticReader {
+  public:
+    explicit ThreadedStaticReader(unsigned int threads) {
+      for (unsigned int i = 0; i < max(threads, 1u); i++)
+        workers.emplace_back(&ThreadedStaticReader::work, this);
+    }
+
+    ~ThreadedStaticReader() {
+      {
+        lock_guard<std::mutex> guard(mutex);
+        is_stopping = true;
+      }
+      wake.notify_all();
+      for (auto &worker : workers) worker.join();
+    }
+
+    void read(const string &path, Callback callback) override {
+      {
+        lock_guard<std::mutex> guard(mutex);
+        queue.emplace_back(path, std::move(callback));
+      }
+      wake.notify_one();
+    }
+
+    string name() override { return "threads"; }
+
+  private:
+    std::mutex mutex;
+    condition_variable wake;
+    bool is_stopping = false;
+    deque<pair<string, Callback>> queue;
+    vector<thread> workers;
+
+    // Workers drain the queue before they exit, so that every callback is called:
+    void work() {
+      while (true) {
+        unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return is_stopping || !queue.empty(); });
+        if (queue.empty()) return;
+
+        auto [path, callback] = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        callback(ReadFile(path));
+      }
+    }
+};
+
+#ifdef PRAILS_WITH_LIBURING
+// Reads are submitted from the calling thread, and completed from a single
+// reaper thread. We never have more than depth reads submitted to the kernel, so
+// that the completion queue can't overflow. Anything beyond that waits in a
+// backlog, until a completion frees up a slot.
+//
+// Reads that the kernel won't take, are failed. Should the ring itself fail, 
+// everything outstanding is failed, and we go on to read on the calling thread.
+class UringStaticReader : public StaticReader {
+  public:
+    explicit UringStaticReader(unsigned int depth) : depth(depth) {
+      if (int ret = io_uring_queue_init(depth, &ring, 0); ret < 0)
+        throw runtime_error(string("Unable to initialize io_uring: ")+strerror(-ret));
+
+      reaper = thread(&UringStaticReader::reap, this);
+    }
+
+    ~UringStaticReader() {
+      // A nop without a Read, tells the reaper to exit once it's idle. Failures
+      // to submit are transient here, since the reaper is draining the ring:
+      while (true) {
+        lock_guard<std::mutex> guard(mutex);
+        if (is_broken || submit(nullptr)) break;
+        this_thread::sleep_for(chrono::milliseconds(1));
+      }
+      reaper.join();
+      io_uring_queue_exit(&ring);
+    }
+
+    void read(const string &path, Callback callback) override {
+      // Opening the file is a metadata lookup, which the index has (almost
+      // certainly) already brought into the dentry cache:
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) return callback(nullopt);
+
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+        close(fd);
+        return callback(nullopt);
+      }
+
+      if (st.st_size == 0) {
+        close(fd);
+        return callback(string());
+      }
+
+      {
+        lock_guard<std::mutex> guard(mutex);
+        if (is_broken) {
+          close(fd);
+          return callback(ReadFile(path));
+        }
+      }
+
+      auto read = new Read({fd, string(st.st_size, '\0'), 0, std::move(callback)});
+
+      {
+        lock_guard<std::mutex> guard(mutex);
+        in_flight++;
+        if (submit(read)) return;
+      }
+
+      finish(read);
+    }
+
+    string name() override { return "io_uring"; }
+
+  private:
+    struct Read {
+      int fd;
+      string content;
+      size_t offset;
+      Callback callback;
+    };
+
+    struct io_uring ring;
+    unsigned int depth;
+    unsigned int submitted = 0;
+    unsigned int in_flight = 0;
+    bool is_broken = false;
+    std::mutex mutex;
+    deque<Read *> backlog;
+    unordered_set<Read *> in_kernel;
+    thread reaper;
+
+    // Marks an sqe that the kernel refused. Its completion is ignored:
+    Read refused = {-1, string(), 0, nullptr};
+
+    // This expects the mutex to be held. Returns false if the kernel wouldn't 
+    // take the read, which the caller is then expected to finish():
+    bool submit(Read *read) {
+      struct io_uring_sqe *sqe = (submitted < depth) ? io_uring_get_sqe(&ring) : nullptr;
+      if (!sqe) {
+        backlog.push_back(read);
+        return true;
+      }
+
+      if (read)
+        io_uring_prep_read(sqe, read->fd, read->content.data()+read->offset,
+          read->content.size()-read->offset, read->offset);
+      else
+        io_uring_prep_nop(sqe);
+
+      io_uring_sqe_set_data(sqe, read);
+      submitted++;
+
+      int ret;
+      while ((ret = io_uring_submit(&ring)) == -EINTR);
+      if (ret >= 0) {
+        if (read) in_kernel.insert(read);
+        return true;
+      }
+
+      // (ie -EBUSY, -EAGAIN or -ENOMEM) The sqe is still in the ring, and goes 
+      // to the kernel with the next submission. So, rather than point it at a 
+      // Read that's about to be failed, we make it a nop that's ignored:
+      io_uring_prep_nop(sqe);
+      io_uring_sqe_set_data(sqe, &refused);
+      return false;
+    }
+
+    // Calls back with whatever was read, which is nothing, unless all of it was:
+    void finish(Read *read) {
+      close(read->fd);
+      read->callback((read->offset == read->content.size()) ?
+        make_optional(std::move(read->content)) : nullopt);
+      delete read;
+
+      lock_guard<std::mutex> guard(mutex);
+      in_flight--;
+    }
+
+    void reap() {
+      bool is_stopping = false;
+
+      while (true) {
+        struct io_uring_cqe *cqe;
+        int ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret == -EINTR) continue;
+        if (ret < 0) return abandon();
+
+        auto read = static_cast<Read *>(io_uring_cqe_get_data(cqe));
+        int res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+
+        vector<Read *> finished;
+        {
+          lock_guard<std::mutex> guard(mutex);
+          submitted--;
+          in_kernel.erase(read);
+
+          if (read == &refused)
+            ;
+          else if (!read)
+            is_stopping = true;
+          else if ((res == -EAGAIN) || (res == -EINTR)) {
+            if (!submit(read)) finished.push_back(read);
+          } else if (res <= 0)
+            finished.push_back(read);
+          else if ((read->offset += res) < read->content.size()) {
+            // A short read. We resume from where it left off:
+            if (!submit(read)) finished.push_back(read);
+          } else
+            finished.push_back(read);
+
+          while (!backlog.empty() && (submitted < depth)) {
+            auto next = backlog.front();
+            backlog.pop_front();
+            if (!submit(next)) finished.push_back(next);
+          }
+        }
+
+        for (auto read : finished) finish(read);
+
+        lock_guard<std::mutex> guard(mutex);
+        if (is_stopping && (in_flight == 0)) break;
+      }
+    }
+
+    // The ring failed us. The backlog is failed, as are the reads that are in
+    // the kernel. Those may still be written to, so their buffers are leaked,
+    // rather than freed. Subsequent reads are made on the calling thread:
+    void abandon() {
+      deque<Read *> unsubmitted;
+      unordered_set<Read *> abandoned;
+      {
+        lock_guard<std::mutex> guard(mutex);
+        is_broken = true;
+        unsubmitted.swap(backlog);
+        abandoned.swap(in_kernel);
+        in_flight = 0;
+      }
+
+      for (auto read : unsubmitted) {
+        close(read->fd);
+        read->callback(nullopt);
+        delete read;
+      }
+
+      for (auto read : abandoned) {
+        auto callback = std::move(read->callback);
+        callback(nullopt);
+      }
+    }
+};
+#endif
+
+unique_ptr<StaticReader> StaticReader::Create(const string &backend,
+  unsigned int threads) {
+
+  if (backend == "io_uring") {
+    #ifdef PRAILS_WITH_LIBURING
+    try {
+      return make_unique<UringStaticReader>(256);
+    } catch (const runtime_error &) {
+      // Most likely, an older kernel, or a seccomp policy that disallows it.
+    }
+    #endif
+    return make_unique<ThreadedStaticReader>(threads);
+  }
+
+  if (backend == "threads") return make_unique<ThreadedStaticReader>(threads);
+
+  throw invalid_argument("Unsupported static reader: "+backend);
+}
+
+bool StaticReader::IsUringAvailable() {
+  #ifdef PRAILS_WITH_LIBURING
+  struct io_uring ring;
+  if (io_uring_queue_init(1, &ring, 0) < 0) return false;
+  io_uring_queue_exit(&ring);
+  return true;
+  #else
+  return false;
+  #endif
+}
@@ -0,0 +1,339 @@
+#include <optional>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <regex>
+#include <ostream>
+#include <sys/stat.h>
+
+#include "template_cache.hpp"
+#include "inja.hpp"
+
+using namespace std;
+
+struct TemplateCache::Entry {
+  inja::Template tmpl;
+
+  // Layouts that can be streamed, are split at their {{ content }}. In which 
+  // case, tmpl is everything before it, and this is everything after:
+  optional<inja::Template> tail;
+
+  vector<pair<string, timespec>> dependencies;
+};
+
+struct TemplateCache::Generation {
+  inja::Environment env;
+  map<string, Entry> templates;
+  map<string, Entry> layouts;
+
+  // Some templates are parsed by a parser of our own, since the environment's 
+  // only parses files, and only reads includes from disk. These are the 
+  // environment's defaults:
+  inja::ParserConfig parser_config;
+  inja::LexerConfig lexer_config;
+  inja::TemplateStorage includes;
+
+  // The includes that we've handed to the environment. Each is handed over once,
+  // since a render that's paused (by a nested render) may be in the middle of it:
+  set<string> included;
+};
+
+// Writes straight into a string of ours, so that the output can be moved out of 
+// it, rather than copied (as an ostringstream::str() would be):
+class StringOutput : public streambuf {
+  public:
+    explicit StringOutput(string &output) : output(output) {}
+
+  protected:
+    streamsize xsputn(const char *s, streamsize n) override {
+      output.append(s, n);
+      return n;
+    }
+
+    int_type overflow(int_type ch) override {
+      if (!traits_type::eq_int_type(ch, traits_type::eof())) 
+        output.push_back(traits_type::to_char_type(ch));
+      return ch;
+    }
+
+  private:
+    string &output;
+};
+
+// Gives up a shared lock that this thread holds, for as long as we're in scope:
+class SharedUnlock {
+  public:
+    explicit SharedUnlock(shared_mutex &mutex) : mutex(mutex) { mutex.unlock_shared(); }
+    ~SharedUnlock() { mutex.lock_shared(); }
+    SharedUnlock(const SharedUnlock &) = delete;
+    SharedUnlock &operator=(const SharedUnlock &) = delete;
+
+  private:
+    shared_mutex &mutex;
+};
+
+static optional<timespec> Mtime(const string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return nullopt;
+  return st.st_mtim;
+}
+
+TemplateCache::TemplateCache(bool is_revalidating, Setup setup, Loader loader) :
+  is_revalidating(is_revalidating), setup(setup), loader(loader),
+  generation(create_generation()) {}
+
+TemplateCache::~TemplateCache() {}
+
+shared_ptr<TemplateCache::Generation> TemplateCache::create_generation() {
+  auto ret = make_shared<Generation>();
+  if (setup) setup(ret->env);
+  return ret;
+}
+
+string TemplateCache::render(const string &path, const nlohmann::json &data) {
+  // A callback (ie, cache()) may render one of our templates, while this thread
+  // is already rendering, and holds our shared lock. That lock is still ours, so
+  // we don't take it again. To parse, we trade it for the exclusive lock, and
+  // take it back once we're done. (The render that's paused, holds on to its
+  // generation, in case ours is replaced in the meantime)
+  bool is_nested = (rendering_cache == this);
+
+  while (true) {
+    {
+      shared_lock<shared_mutex> lock(mutex, defer_lock);
+      if (!is_nested) lock.lock();
+
+      auto current = generation;
+      if (auto entry = find(*current, path, false); entry) {
+        string ret;
+        StringOutput buffer(ret);
+        ostream output(&buffer);
+        render_to(output, *current, path, entry->tmpl, data);
+        return ret;
+      }
+    }
+
+    optional<SharedUnlock> unlocked;
+    if (is_nested) unlocked.emplace(mutex);
+
+    unique_lock<shared_mutex> lock(mutex);
+    ensure(path, false);
+  }
+}
+
+string TemplateCache::render(const string &layout_path, const string &view_path,
+  nlohmann::json &data) {
+  // Pages of an action tend to be similar in size, so we start with room for 
+  // the last one that this thread rendered:
+  static thread_local size_t last_size = 0;
+
+  while (true) {
+    {
+      shared_lock<shared_mutex> lock(mutex);
+      auto current = generation;
+      auto layout = find(*current, layout_path, true);
+      auto view = find(*current, view_path, false);
+      if (layout && view) {
+        string ret;
+        ret.reserve(last_size);
+        StringOutput buffer(ret);
+        ostream output(&buffer);
+
+        if (layout->tail) {
+          render_to(output, *current, layout_path, layout->tmpl, data);
+          render_to(output, *current, view_path, view->tmpl, data);
+          render_to(output, *current, layout_path, *layout->tail, data);
+        } else {
+          string content;
+          StringOutput content_buffer(content);
+          ostream content_output(&content_buffer);
+          render_to(content_output, *current, view_path, view->tmpl, data);
+
+          data["content"] = std::move(content);
+          render_to(output, *current, layout_path, layout->tmpl, data);
+        }
+
+        last_size = ret.size();
+        return ret;
+      }
+    }
+
+    unique_lock<shared_mutex> lock(mutex);
+    ensure(layout_path, true);
+    ensure(view_path, false);
+  }
+}
+
+void TemplateCache::render_to(ostream &output, Generation &rendering, 
+  const string &path, const inja::Template &tmpl, const nlohmann::json &data) {
+  string previous_path = std::exchange(rendering_path, path);
+  TemplateCache *previous_cache = std::exchange(rendering_cache, this);
+  try {
+    rendering.env.render_to(output, tmpl, data);
+    rendering_path = previous_path;
+    rendering_cache = previous_cache;
+  } catch (...) {
+    rendering_path = previous_path;
+    rendering_cache = previous_cache;
+    throw;
+  }
+}
+
+const TemplateCache::Entry *TemplateCache::find(Generation &in, 
+  const string &path, bool is_layout) {
+  auto &entries = (is_layout) ? in.layouts : in.templates;
+  auto entry = entries.find(path);
+  if ((entry == entries.end()) || (is_revalidating && is_stale(entry->second)))
+    return nullptr;
+  return &entry->second;
+}
+
+void TemplateCache::ensure(const string &path, bool is_layout) {
+  // Another thread may have beaten us to it, while we waited on the lock:
+  auto &entries = (is_layout) ? generation->layouts : generation->templates;
+  if (auto entry = entries.find(path); entry != entries.end()) {
+    if (!is_revalidating || !is_stale(entry->second)) return;
+    generation = create_generation();
+  }
+
+  // Everything is parsed by our own parser (rather than the environment's 
+  // parse_template()), so that the environment only gets its includes from us:
+  Entry parsed;
+  optional<string_view> loaded = (loader) ? loader(path) : nullopt;
+  string text = (loaded) ? string(*loaded) : generation->env.load_file(path);
+  if (is_layout)
+    parse_layout(parsed, path, text);
+  else
+    parsed.tmpl = parse_text(path, text);
+
+  if (is_revalidating && !loaded) {
+    set<string> dependencies = {path};
+    for (const auto *tmpl : {&parsed.tmpl, (parsed.tail) ? &*parsed.tail : nullptr})
+      if (tmpl) add_includes(*tmpl, dependencies);
+
+    for (const auto &dependency : dependencies)
+      if (auto mtime = Mtime(dependency); mtime)
+        parsed.dependencies.emplace_back(dependency, *mtime);
+  }
+
+  // The generation may have changed above:
+  ((is_layout) ? generation->layouts : generation->templates)[path] = 
+    std::move(parsed);
+}
+
+void TemplateCache::parse_layout(Entry &entry, const string &path, 
+  const string &text) {
+  static const regex content_expression(R"re(\{\{\s*content\s*\}\})re");
+
+  // We can only stream a layout that prints its content once, and at the top 
+  // level (ie, not inside an if or a for, which wouldn't parse once split). 
+  // Otherwise, the content is rendered into the data, as it always was:
+  smatch match;
+  if (regex_search(text, match, content_expression) && 
+    !regex_search(match.suffix().first, text.cend(), content_expression)) {
+    try {
+      auto head = parse_text(path, match.prefix().str());
+      auto tail = parse_text(path, match.suffix().str());
+      if (!is_referencing(head, "content") && !is_referencing(tail, "content")) {
+        entry.tmpl = std::move(head);
+        entry.tail = std::move(tail);
+        return;
+      }
+    } catch (const runtime_error &) {}
+  }
+
+  entry.tmpl = parse_text(path, text);
+}
+
+inja::Template TemplateCache::parse_text(const string &path, 
+  string_view content) {
+  static const regex include_statement(
+    R"re(\{%-?\s*include\s+"([^"]+)"\s*-?%\})re");
+
+  string folder = path.substr(0, path.find_last_of('/')+1);
+  string text(content);
+
+  // inja would read these includes from disk, unless they're already parsed. So, 
+  // any that the loader has, we parse first:
+  if (loader)
+    for (sregex_iterator it(text.begin(), text.end(), include_statement), end; 
+      it != end; ++it) {
+      string include_path = folder+(*it)[1].str();
+      if (include_path.compare(0, 2, "./") == 0) include_path.erase(0, 2);
+      if (generation->includes.count(include_path) > 0) continue;
+
+      if (auto included = loader(include_path); included)
+        generation->includes[include_path] = parse_text(include_path, *included);
+    }
+
+  auto ret = inja::Parser(generation->parser_config, generation->lexer_config, 
+    generation->includes).parse(text, folder);
+
+  // Including those that the parser itself read from disk:
+  for (const auto &[include_path, tmpl] : generation->includes)
+    if (generation->included.insert(include_path).second)
+      generation->env.include_template(include_path, tmpl);
+
+  return ret;
+}
+
+// The paths of everything that the template includes, and that those include, 
+// and so on:
+void TemplateCache::add_includes(const inja::Template &tmpl, set<string> &paths) {
+  for (const auto &bytecode : tmpl.bytecodes) {
+    if (bytecode.op != inja::Bytecode::Op::Include) continue;
+
+    auto include_path = bytecode.value.get<string>();
+    if (!paths.insert(include_path).second) continue;
+
+    auto included = generation->includes.find(include_path);
+    if (included != generation->includes.end()) 
+      add_includes(included->second, paths);
+  }
+}
+
+// Whether the template (or anything it includes) looks up the named variable:
+bool TemplateCache::is_referencing(const inja::Template &tmpl, 
+  const string &name) {
+  for (const auto &bytecode : tmpl.bytecodes) {
+    if (bytecode.op == inja::Bytecode::Op::Include) {
+      auto included = generation->includes.find(bytecode.value.get<string>());
+      if ((included != generation->includes.end()) && 
+        is_referencing(included->second, name))
+        return true;
+      continue;
+    }
+
+    if ((bytecode.flags != inja::Bytecode::Flag::ValueLookupDot) && 
+      (bytecode.flags != inja::Bytecode::Flag::ValueLookupPointer))
+      continue;
+
+    for (const auto &prefix : {name, "/"+name})
+      if ((bytecode.str.compare(0, prefix.size(), prefix) == 0) &&
+        ((bytecode.str.size() == prefix.size()) || 
+          (bytecode.str[prefix.size()] == '.') || 
+          (bytecode.str[prefix.size()] == '/')))
+        return true;
+  }
+  return false;
+}
+
+bool TemplateCache::is_stale(const Entry &entry) {
+  for (const auto &[path, mtime] : entry.dependencies) {
+    auto current = Mtime(path);
+    if (!current || (current->tv_sec != mtime.tv_sec) ||
+      (current->tv_nsec != mtime.tv_nsec))
+      return true;
+  }
+  return false;
+}
+
+size_t TemplateCache::size() {
+  shared_lock<shared_mutex> lock(mutex);
+  return generation->templates.size()+generation->layouts.size();
+}
+
+void TemplateCache::clear() {
+  unique_lock<shared_mutex> lock(mutex);
+  generation = create_generation();
+}
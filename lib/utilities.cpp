@@ -133,6 +133,24 @@ tm iso8601_to_tm(const string &time_as_string) {
   return ret;
 }
 
+// These are the IMF-fixdate's used by the Last-Modified and If-Modified-Since
+// headers. (See RFC 7231, Section 7.1.1.1)
+string time_to_http_date(time_t t) {
+  tm tm_time;
+  char buffer [80];
+  gmtime_r(&t, &tm_time);
+  strftime(buffer,80,"%a, %d %b %Y %H:%M:%S GMT",&tm_time);
+  return string(buffer);
+}
+
+optional<time_t> http_date_to_time(const string &http_date) {
+  tm ret;
+  memset(&ret, 0, sizeof(tm));
+  if (strptime(http_date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &ret) == nullptr)
+    return nullopt;
+  return timegm(&ret);
+}
+
 pair<int,string> capture_system(const string &cmd) {
 	array<char, 128> buffer;
 	string output;
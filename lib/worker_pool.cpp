@@ -0,0 +1,94 @@
+#include <stdexcept>
+
+#include "spdlog/spdlog.h"
+
+#include "worker_pool.hpp"
+
+using namespace std;
+
+WorkerPool::WorkerPool(unsigned int threads, const CpuSet &cpus) : cpus(cpus) {
+  if (threads == 0) throw invalid_argument("A worker pool requires a thread");
+
+  for (unsigned int i = 0; i < threads; i++) queues.push_back(make_unique<Queue>());
+  for (unsigned int i = 0; i < threads; i++) workers.emplace_back(&WorkerPool::work, this, i);
+}
+
+WorkerPool::~WorkerPool() { shutdown(); }
+
+void WorkerPool::submit(Task task) {
+  size_t index = (current_pool == this) ? current_worker :
+    next_queue.fetch_add(1, memory_order_relaxed) % queues.size();
+
+  // This is counted before the task is queued, so that the count never falls
+  // below zero. The idle lock ensures that a worker which has just found nothing
+  // to do, isn't about to wait, and miss this:
+  {
+    lock_guard<std::mutex> guard(idle_mutex);
+    pending_.fetch_add(1, memory_order_release);
+  }
+
+  {
+    lock_guard<std::mutex> guard(queues[index]->mutex);
+    queues[index]->tasks.push_back(std::move(task));
+  }
+  idle.notify_one();
+}
+
+// Workers drain the queues before they exit, so that every task is run:
+void WorkerPool::shutdown() {
+  {
+    lock_guard<std::mutex> guard(idle_mutex);
+    if (is_stopping) return;
+    is_stopping = true;
+  }
+  idle.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+// Our own queue is taken from the front, so that tasks run in (about) the order
+// they arrived. Others' are taken from the back, which is furthest from where
+// their owner is working:
+bool WorkerPool::pop(size_t index, Task &task) {
+  for (size_t i = 0; i < queues.size(); i++) {
+    auto &queue = *queues[(index+i) % queues.size()];
+    lock_guard<std::mutex> guard(queue.mutex);
+    if (queue.tasks.empty()) continue;
+
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    pending_.fetch_sub(1, memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+void WorkerPool::work(size_t index) {
+  current_pool = this;
+  current_worker = index;
+  if (!cpus.empty()) cpus.pin();
+
+  Task task;
+  while (true) {
+    if (pop(index, task)) {
+      // Tasks are expected to handle their own errors. But, a worker shouldn't
+      // die because one didn't:
+      try { task(); }
+      catch (const exception &e) { 
+        if (auto logger = spdlog::get("server"); logger)
+          logger->error("Uncaught exception in worker: {}", e.what());
+      }
+      task = nullptr;
+      continue;
+    }
+
+    unique_lock<std::mutex> lock(idle_mutex);
+    idle.wait(lock, [this]() { 
+      return is_stopping || (pending_.load(memory_order_acquire) > 0); });
+    if (is_stopping && (pending_.load(memory_order_acquire) == 0)) return;
+  }
+}
@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "admission_control.hpp"
+
+using namespace std;
+
+// Queued requests are admitted (or shed) on the dispatcher thread. So, we record
+// their results under a lock, and wait for them to arrive:
+template <typename T>
+class Results {
+  public:
+    void push_back(T result) {
+      lock_guard<mutex> guard(results_mutex);
+      results.push_back(result);
+    }
+
+    vector<T> get() {
+      lock_guard<mutex> guard(results_mutex);
+      return results;
+    }
+
+    vector<T> wait_for(size_t size) {
+      auto deadline = chrono::steady_clock::now()+chrono::seconds(5);
+      while ((get().size() < size) && (chrono::steady_clock::now() < deadline))
+        this_thread::sleep_for(chrono::milliseconds(1));
+      return get();
+    }
+
+  private:
+    mutex results_mutex;
+    vector<T> results;
+};
+
+TEST(AdmissionControl, sheds_beyond_the_limit) {
+  AdmissionControl admission(2);
+
+  EXPECT_TRUE(admission.try_acquire());
+  EXPECT_TRUE(admission.try_acquire());
+  EXPECT_FALSE(admission.try_acquire());
+  EXPECT_EQ(admission.in_flight(), 2);
+
+  // Without a queue, acquire() sheds immediately:
+  optional<bool> result;
+  admission.acquire([&result](bool is_admitted) { result = is_admitted; });
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(*result);
+  EXPECT_EQ(admission.waiting(), 0);
+
+  admission.release();
+  EXPECT_EQ(admission.in_flight(), 1);
+  EXPECT_TRUE(admission.try_acquire());
+}
+
+TEST(AdmissionControl, queues_until_released) {
+  AdmissionControl admission(1, 2, chrono::seconds(10));
+  Results<string> results;
+
+  admission.acquire([&results](bool ok) { results.push_back(ok ? "a" : "!a"); });
+  admission.acquire([&results](bool ok) { results.push_back(ok ? "b" : "!b"); });
+  admission.acquire([&results](bool ok) { results.push_back(ok ? "c" : "!c"); });
+
+  // The queue is full:
+  admission.acquire([&results](bool ok) { results.push_back(ok ? "d" : "!d"); });
+
+  EXPECT_EQ(results.get(), vector<string>({"a", "!d"}));
+  EXPECT_EQ(admission.waiting(), 2);
+
+  // Releasing hands the slot to the oldest waiter:
+  admission.release();
+  EXPECT_EQ(results.wait_for(3), vector<string>({"a", "!d", "b"}));
+  EXPECT_EQ(admission.in_flight(), 1);
+
+  admission.release();
+  EXPECT_EQ(results.wait_for(4), vector<string>({"a", "!d", "b", "c"}));
+  admission.release();
+  EXPECT_EQ(admission.in_flight(), 0);
+  EXPECT_EQ(admission.waiting(), 0);
+}
+
+TEST(AdmissionControl, sheds_expired_waiters) {
+  AdmissionControl admission(1, 4, chrono::milliseconds(20));
+  Results<bool> results;
+
+  ASSERT_TRUE(admission.try_acquire());
+  admission.acquire([&results](bool ok) { results.push_back(ok); });
+  EXPECT_TRUE(results.get().empty());
+
+  // Waiters are shed at their deadline, without any other request coming along:
+  EXPECT_EQ(results.wait_for(1), vector<bool>({false}));
+  EXPECT_EQ(admission.waiting(), 0);
+
+  admission.release();
+  EXPECT_EQ(admission.in_flight(), 0);
+}
+
+TEST(AdmissionControl, concurrent_requests) {
+  const unsigned int limit = 4;
+  AdmissionControl admission(limit, 1024, chrono::seconds(10));
+  atomic<unsigned int> running(0), max_running(0), admitted(0);
+
+  vector<thread> threads;
+  for (unsigned int t = 0; t < 8; t++)
+    threads.emplace_back([&]() {
+      for (unsigned int i = 0; i < 1000; i++)
+        admission.acquire([&](bool ok) {
+          if (!ok) return;
+          unsigned int now = ++running;
+          for (auto seen = max_running.load(); now > seen && 
+            !max_running.compare_exchange_weak(seen, now); ) ;
+          admitted++;
+          running--;
+          admission.release();
+        });
+    });
+  for (auto &t : threads) t.join();
+
+  auto deadline = chrono::steady_clock::now()+chrono::seconds(5);
+  while ((admitted < 8000) && (chrono::steady_clock::now() < deadline))
+    this_thread::sleep_for(chrono::milliseconds(1));
+
+  EXPECT_LE(max_running, limit);
+  EXPECT_EQ(admitted, 8000);
+  EXPECT_EQ(admission.in_flight(), 0);
+  EXPECT_EQ(admission.waiting(), 0);
+}
+
+TEST(AdmissionControl, admits_without_recursion) {
+  // Each admitted request releases from inside its continuation, as a request 
+  // that runs without a worker pool does. Those it admits in turn, must not run
+  // on its stack:
+  const unsigned int queued = 10000;
+  AdmissionControl admission(1, queued, chrono::seconds(10));
+  atomic<unsigned int> admitted(0), depth(0), max_depth(0);
+
+  ASSERT_TRUE(admission.try_acquire());
+  for (unsigned int i = 0; i < queued; i++)
+    admission.acquire([&](bool ok) {
+      if (!ok) return;
+      unsigned int now = ++depth;
+      if (now > max_depth) max_depth = now;
+      admitted++;
+      admission.release();
+      depth--;
+    });
+  admission.release();
+
+  auto deadline = chrono::steady_clock::now()+chrono::seconds(5);
+  while ((admitted < queued) && (chrono::steady_clock::now() < deadline))
+    this_thread::sleep_for(chrono::milliseconds(1));
+
+  EXPECT_EQ(admitted, queued);
+  EXPECT_EQ(max_depth, 1u);
+}
+
+TEST(AdmissionControl, requires_a_limit) {
+  EXPECT_THROW(AdmissionControl(0), invalid_argument);
+}
@@ -0,0 +1,111 @@
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include "asset_manifest.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+class AssetManifestFixture : public ::testing::Test {
+  protected:
+    string root;
+
+    void SetUp() override {
+      root = filesystem::temp_directory_path().string()+"/asset_manifest_test_"+
+        to_string(getpid());
+      filesystem::create_directories(root+"/public/js");
+      write("public/js/app.js", "var a = 1;");
+      write("public/js/app.js.gz", "not-really-gzip");
+      write("public/site.css", "body {}");
+    }
+
+    void TearDown() override {
+      filesystem::remove_all(root);
+    }
+
+    void write(const string &name, const string &content) {
+      ofstream out(root+"/"+name);
+      out << content;
+      out.close();
+    }
+};
+
+TEST(AssetManifest, Fingerprint) {
+  EXPECT_EQ(AssetManifest::Fingerprint("/js/app.js", "3f9c1a2b4d5e6f"), 
+    "/js/app.3f9c1a2b4d.js");
+  EXPECT_EQ(AssetManifest::Fingerprint("/js/app.min.js", "3f9c1a2b4d5e6f"), 
+    "/js/app.min.3f9c1a2b4d.js");
+  EXPECT_EQ(AssetManifest::Fingerprint("/LICENSE", "3f9c1a2b4d5e6f"), 
+    "/LICENSE.3f9c1a2b4d");
+  EXPECT_EQ(AssetManifest::Fingerprint("/.well-known/thing", "3f9c1a2b4d5e6f"), 
+    "/.well-known/thing.3f9c1a2b4d");
+  EXPECT_EQ(AssetManifest::Fingerprint("/img/.hidden", "3f9c1a2b4d5e6f"), 
+    "/img/.hidden.3f9c1a2b4d");
+}
+
+TEST_F(AssetManifestFixture, build) {
+  AssetManifest manifest(root+"/public");
+  manifest.build();
+
+  // Sidecars aren't fingerprinted:
+  EXPECT_EQ(manifest.size(), 2);
+
+  // This is the sha256 of "var a = 1;":
+  auto app_js = manifest.path_for("/js/app.js");
+  ASSERT_TRUE(app_js.has_value());
+  EXPECT_EQ(*app_js, "/js/app.f9d67ab9db.js");
+  EXPECT_EQ(manifest.resource_for(*app_js), "/js/app.js");
+
+  EXPECT_TRUE(manifest.path_for("/site.css").has_value());
+  EXPECT_FALSE(manifest.path_for("/missing.css").has_value());
+  EXPECT_FALSE(manifest.resource_for("/js/app.js").has_value());
+}
+
+TEST_F(AssetManifestFixture, save_and_load) {
+  AssetManifest built(root+"/public");
+  built.build();
+  built.save(root+"/assets.json");
+
+  AssetManifest loaded(root+"/public");
+  loaded.load(root+"/assets.json");
+  EXPECT_EQ(loaded.size(), 2);
+  EXPECT_EQ(loaded.path_for("/js/app.js"), built.path_for("/js/app.js"));
+
+  // Assets that changed since they were fingerprinted, are dropped:
+  write("public/site.css", "body { color: red; }");
+  loaded.load(root+"/assets.json");
+  EXPECT_EQ(loaded.size(), 1);
+  EXPECT_FALSE(loaded.path_for("/site.css").has_value());
+
+  // Including those whose size and mtime are unchanged:
+  string app_js = root+"/public/js/app.js";
+  auto mtime = filesystem::last_write_time(app_js);
+  write("public/js/app.js", "var b = 2;");
+  filesystem::last_write_time(app_js, mtime);
+  loaded.load(root+"/assets.json");
+  EXPECT_EQ(loaded.size(), 0);
+
+  // Whereas those that were only touched, are kept:
+  write("public/js/app.js", "var a = 1;");
+  filesystem::last_write_time(app_js, mtime+chrono::seconds(5));
+  loaded.load(root+"/assets.json");
+  EXPECT_EQ(loaded.path_for("/js/app.js"), built.path_for("/js/app.js"));
+
+  EXPECT_THROW(loaded.load(root+"/missing.json"), runtime_error);
+}
+
+TEST_F(AssetManifestFixture, invalidate) {
+  AssetManifest manifest(root+"/public");
+  manifest.build();
+
+  auto app_js = manifest.path_for("/js/app.js");
+  manifest.invalidate(root+"/public/js");
+  EXPECT_FALSE(manifest.path_for("/js/app.js").has_value());
+  EXPECT_FALSE(manifest.resource_for(*app_js).has_value());
+  EXPECT_EQ(manifest.size(), 1);
+
+  manifest.invalidate(root+"/public");
+  EXPECT_EQ(manifest.size(), 0);
+}
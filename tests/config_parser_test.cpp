@@ -19,9 +19,20 @@ TEST(config_parser, test_server_config) {
     string(PROJECT_SOURCE_DIR)+"/tests/views");
   EXPECT_EQ(config.config_path(), 
     string(PROJECT_SOURCE_DIR)+"/tests/config");
+  EXPECT_EQ(config.asset_manifest(), 
+    string(PROJECT_SOURCE_DIR)+"/tests/config/assets.json");
   EXPECT_EQ(config.log_directory(), 
     string(PROJECT_SOURCE_DIR)+"/build/log");
   EXPECT_EQ(config.log_level(), "off");
   EXPECT_EQ(config.spdlog_level(), spdlog::level::off);
   EXPECT_EQ(config.dsn(), "sqlite3://:memory:");
+
+  // These are unset, and thus their defaults:
+  EXPECT_EQ(config.worker_threads(), 0);
+  EXPECT_EQ(config.db_pool_size(), 1);
+  EXPECT_EQ(config.max_in_flight(), 0);
+  EXPECT_TRUE(config.action_max_in_flight().empty());
+  EXPECT_TRUE(config.rate_limits().empty());
+  EXPECT_EQ(config.view_cache(), "development");
+  EXPECT_EQ(config.fragment_cache_size(), 16u * 1024 * 1024);
 }
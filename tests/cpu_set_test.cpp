@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "cpu_set.hpp"
+
+using namespace std;
+
+TEST(CpuSet, parse) {
+  EXPECT_EQ(CpuSet("0").cpus(), vector<unsigned int>({0}));
+  EXPECT_EQ(CpuSet("0-3,8").cpus(), vector<unsigned int>({0, 1, 2, 3, 8}));
+  EXPECT_EQ(CpuSet("10-11,2,2,1-2").cpus(), vector<unsigned int>({1, 2, 10, 11}));
+
+  EXPECT_EQ(CpuSet("10-11,2,1-2").to_string(), "1-2,10-11");
+  EXPECT_EQ(CpuSet("0,2,4-6").to_string(), "0,2,4-6");
+
+  EXPECT_THROW(CpuSet(""), invalid_argument);
+  EXPECT_THROW(CpuSet("a"), invalid_argument);
+  EXPECT_THROW(CpuSet("3-1"), invalid_argument);
+  EXPECT_THROW(CpuSet("0,"), invalid_argument);
+  EXPECT_THROW(CpuSet("0-99999"), invalid_argument);
+}
+
+TEST(CpuSet, at) {
+  CpuSet cpus("4-5,9");
+  EXPECT_EQ(cpus.at(0).cpus(), vector<unsigned int>({4}));
+  EXPECT_EQ(cpus.at(2).cpus(), vector<unsigned int>({9}));
+  EXPECT_EQ(cpus.at(3).cpus(), vector<unsigned int>({4}));
+  EXPECT_THROW(CpuSet().at(0), out_of_range);
+}
+
+TEST(CpuSet, pin) {
+  auto original = CpuSet::OfThread();
+  ASSERT_FALSE(original.empty());
+
+  // Threads inherit the set of the thread that created them:
+  original.at(0).pin();
+  CpuSet inherited;
+  thread([&inherited]() { inherited = CpuSet::OfThread(); }).join();
+  EXPECT_EQ(inherited.cpus(), original.at(0).cpus());
+
+  original.pin();
+  EXPECT_EQ(CpuSet::OfThread().cpus(), original.cpus());
+
+  // Threads that have exited are skipped, rather than thrown on:
+  pid_t exited;
+  thread([&exited]() { exited = CpuSet::CurrentThread(); }).join();
+  EXPECT_FALSE(original.pin(exited));
+  EXPECT_TRUE(original.pin(CpuSet::CurrentThread()));
+}
@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+
+#include "embedded_views.hpp"
+#include "template_cache.hpp"
+#include "utilities.hpp"
+
+using namespace std;
+using namespace prails::utilities;
+
+// The views in tests/embedded_views are compiled into this test, by 
+// prails_embed_views(), in our CMakeLists.txt.
+TEST(EmbeddedViews, find) {
+  string views_path = string(PROJECT_SOURCE_DIR)+"/tests/embedded_views";
+
+  EXPECT_EQ(EmbeddedViews::Size(), 3u);
+
+  for (const auto &path : {"layouts/default.inja.html", "tasks/index.inja.html", 
+    "tasks/_row.inja.html"}) {
+    auto view = EmbeddedViews::Find(path);
+    ASSERT_TRUE(view);
+    EXPECT_EQ(string(*view), read_file(views_path+"/"+path));
+  }
+
+  EXPECT_FALSE(EmbeddedViews::Find("tasks/missing.inja.html"));
+  EXPECT_FALSE(EmbeddedViews::Find("tasks"));
+}
+
+TEST(EmbeddedViews, render) {
+  // Nothing exists at this path, so everything must come from memory:
+  string views_path = "/nonexistent/views";
+
+  TemplateCache cache(true, nullptr, [&](const string &path) -> 
+    optional<string_view> {
+    if (path.compare(0, views_path.size()+1, views_path+"/") != 0) return nullopt;
+    return EmbeddedViews::Find(path.substr(views_path.size()+1));
+  });
+
+  nlohmann::json data = { {"title", "Tasks"}, {"name", "Alice"} };
+  for (unsigned int i = 0; i < 2; i++)
+    EXPECT_EQ(cache.render(views_path+"/tasks/index.inja.html", data), 
+      "<h1>Tasks</h1>\n<p>Caf\xc3\xa9 Alice</p>\n\n");
+
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_THROW(cache.render(views_path+"/tasks/missing.inja.html", data), 
+    runtime_error);
+}
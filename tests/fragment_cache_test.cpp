@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+
+#include "fragment_cache.hpp"
+
+using namespace std;
+
+TEST(FragmentCache, get_and_set) {
+  FragmentCache cache(1024);
+
+  EXPECT_FALSE(cache.get("nav"));
+
+  cache.set("nav", "<nav></nav>", chrono::seconds(60));
+  EXPECT_EQ(*cache.get("nav"), "<nav></nav>");
+  EXPECT_EQ(cache.bytes(), 3u*2+11);
+
+  cache.set("nav", "<nav>Home</nav>", chrono::seconds(60));
+  EXPECT_EQ(*cache.get("nav"), "<nav>Home</nav>");
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(cache.bytes(), 3u*2+15);
+
+  // A zero ttl has already expired:
+  cache.set("sidebar", "<aside></aside>", chrono::seconds(0));
+  EXPECT_FALSE(cache.get("sidebar"));
+  EXPECT_EQ(cache.size(), 1u);
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.bytes(), 0u);
+}
+
+TEST(FragmentCache, fetch) {
+  FragmentCache cache(1024);
+  unsigned int renders = 0;
+  auto render = [&]() { return "rendered "+to_string(++renders); };
+
+  for (unsigned int i = 0; i < 3; i++)
+    EXPECT_EQ(cache.fetch("nav", chrono::seconds(60), render), "rendered 1");
+
+  EXPECT_EQ(cache.fetch("nav", chrono::seconds(0), [&]() { 
+    // Renders may use the cache themselves:
+    return cache.fetch("inner", chrono::seconds(60), render);
+  }), "rendered 1");
+
+  EXPECT_EQ(renders, 1u);
+}
+
+TEST(FragmentCache, renders_once_under_concurrent_fetches) {
+  FragmentCache cache(1024);
+  atomic<unsigned int> renders(0);
+  atomic<unsigned int> mismatches(0);
+  vector<thread> threads;
+
+  for (unsigned int i = 0; i < 8; i++)
+    threads.emplace_back([&]() {
+      auto fragment = cache.fetch("nav", chrono::seconds(60), [&]() {
+        renders++;
+        this_thread::sleep_for(chrono::milliseconds(100));
+        return string("<nav></nav>");
+      });
+      if (fragment != "<nav></nav>") mismatches++;
+    });
+
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(renders, 1u);
+  EXPECT_EQ(mismatches, 0u);
+
+  // A failed render is thrown to everyone waiting on it, and isn't cached:
+  atomic<unsigned int> failures(0);
+  threads.clear();
+  for (unsigned int i = 0; i < 4; i++)
+    threads.emplace_back([&]() {
+      try {
+        cache.fetch("sidebar", chrono::seconds(60), [&]() -> string {
+          this_thread::sleep_for(chrono::milliseconds(100));
+          throw runtime_error("render failed");
+        });
+      } catch (const runtime_error &) {
+        failures++;
+      }
+    });
+
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(failures, 4u);
+  EXPECT_FALSE(cache.get("sidebar"));
+  EXPECT_EQ(cache.fetch("sidebar", chrono::seconds(60), []() { 
+    return string("<aside></aside>"); }), "<aside></aside>");
+}
+
+TEST(FragmentCache, evicts_least_recently_used) {
+  // Room for three fragments of 2+2+10 bytes:
+  FragmentCache cache(42);
+
+  for (const auto &key : {"a1", "a2", "a3"})
+    cache.set(key, "0123456789", chrono::seconds(60));
+  EXPECT_EQ(cache.bytes(), 42u);
+
+  // a1 is now the most recently used, and a2 the least:
+  EXPECT_TRUE(cache.get("a1"));
+  cache.set("a4", "0123456789", chrono::seconds(60));
+
+  EXPECT_TRUE(cache.get("a1"));
+  EXPECT_FALSE(cache.get("a2"));
+  EXPECT_TRUE(cache.get("a3"));
+  EXPECT_TRUE(cache.get("a4"));
+
+  // Fragments larger than the cache are never stored:
+  cache.set("huge", string(64, 'x'), chrono::seconds(60));
+  EXPECT_FALSE(cache.get("huge"));
+  EXPECT_EQ(cache.size(), 3u);
+}
+
+TEST(FragmentCache, erase_prefix) {
+  FragmentCache cache(1024);
+
+  for (const auto &key : {"tasks/1", "tasks/2", "tasks", "taskss/1", "users/1"})
+    cache.set(key, "fragment", chrono::seconds(60));
+
+  EXPECT_EQ(cache.erase_prefix("tasks/"), 2u);
+  EXPECT_FALSE(cache.get("tasks/1"));
+  EXPECT_FALSE(cache.get("tasks/2"));
+  EXPECT_TRUE(cache.get("tasks"));
+  EXPECT_TRUE(cache.get("taskss/1"));
+  EXPECT_TRUE(cache.get("users/1"));
+
+  EXPECT_EQ(cache.erase_prefix(""), 3u);
+  EXPECT_EQ(cache.bytes(), 0u);
+}
+
+TEST(FragmentCache, concurrent) {
+  FragmentCache cache(256);
+  vector<thread> threads;
+  atomic<unsigned int> mismatches(0);
+
+  for (unsigned int i = 0; i < 8; i++)
+    threads.emplace_back([&, i]() {
+      for (unsigned int j = 0; j < 1000; j++) {
+        auto key = "fragment/"+to_string((i+j) % 16);
+        if (cache.fetch(key, chrono::seconds(60), [&]() { return key; }) != key)
+          mismatches++;
+        if (j % 100 == 0) cache.erase_prefix("fragment/1");
+      }
+    });
+
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(mismatches, 0u);
+  EXPECT_LE(cache.bytes(), 256u);
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "http_connection.hpp"
+
+using namespace std;
+
+// Answers every request on a connection with the responder's reply. Connections
+// are served one at a time, which is all that we need here:
+class FakeServer {
+  public:
+    typedef function<string(unsigned int)> Responder;
+
+    FakeServer(Responder responder, bool is_closing = false) :
+      responder(responder), is_closing(is_closing) {
+      listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+      listen(listen_fd, 8);
+
+      socklen_t length = sizeof(addr);
+      getsockname(listen_fd, reinterpret_cast<sockaddr *>(&addr), &length);
+      port = ntohs(addr.sin_port);
+
+      acceptor = thread([this]() { serve(); });
+    }
+
+    ~FakeServer() {
+      shutdown(listen_fd, SHUT_RDWR);
+      close(listen_fd);
+      acceptor.join();
+    }
+
+    unsigned int port;
+    atomic<unsigned int> connections = 0;
+
+  private:
+    Responder responder;
+    bool is_closing;
+    int listen_fd;
+    thread acceptor;
+    unsigned int requests = 0;
+
+    void serve() {
+      for (int fd; (fd = accept(listen_fd, nullptr, nullptr)) >= 0; close(fd)) {
+        connections++;
+
+        string buffer;
+        char chunk[4096];
+        for (ssize_t n; (n = recv(fd, chunk, sizeof(chunk), 0)) > 0; ) {
+          buffer.append(chunk, n);
+          if (buffer.find("\r\n\r\n") == string::npos) continue;
+          buffer.clear();
+
+          string response = responder(requests++);
+          send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+          if (is_closing) break;
+        }
+      }
+    }
+};
+
+TEST(HttpConnection, keep_alive) {
+  FakeServer server([](unsigned int i) {
+    string body = "response "+to_string(i);
+    return "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+      "Content-Length: "+to_string(body.size())+"\r\n\r\n"+body;
+  });
+
+  HttpConnection connection("127.0.0.1", server.port);
+
+  for (unsigned int i = 0; i < 3; i++) {
+    auto response = connection.request("GET", "/");
+    EXPECT_EQ(response.status, 200);
+    EXPECT_EQ(response.body, "response "+to_string(i));
+    EXPECT_EQ(*response.header("Content-Type"), "text/plain");
+  }
+
+  EXPECT_EQ(server.connections, 1u);
+}
+
+TEST(HttpConnection, chunked) {
+  FakeServer server([](unsigned int) {
+    return string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "6\r\nHello \r\n"
+      "b\r\nfrom chunks\r\n"
+      "0\r\n\r\n");
+  });
+
+  HttpConnection connection("127.0.0.1", server.port);
+  EXPECT_EQ(connection.request("GET", "/").body, "Hello from chunks");
+  EXPECT_EQ(connection.request("GET", "/").body, "Hello from chunks");
+  EXPECT_EQ(server.connections, 1u);
+}
+
+TEST(HttpConnection, reconnects) {
+  // The server closes the connection after every response, without saying so:
+  FakeServer server([](unsigned int) {
+    return string("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+  }, true);
+
+  HttpConnection connection("127.0.0.1", server.port);
+  for (unsigned int i = 0; i < 3; i++)
+    EXPECT_EQ(connection.request("GET", "/missing").status, 404);
+
+  EXPECT_EQ(server.connections, 3u);
+}
+
+TEST(HttpConnection, unreachable) {
+  unsigned int port;
+  {
+    // We take a port, and then let it go, so that nothing is listening there:
+    FakeServer server([](unsigned int) { return string(); });
+    port = server.port;
+  }
+
+  HttpConnection connection("127.0.0.1", port);
+  EXPECT_THROW(connection.request("GET", "/"), runtime_error);
+  EXPECT_FALSE(connection.is_connected());
+}
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "include_store.hpp"
+
+using namespace std;
+
+class IncludeStoreTest : public ::testing::Test {
+  protected:
+    filesystem::path root;
+
+    void SetUp() override {
+      root = filesystem::temp_directory_path() / 
+        ("include_store_test."+to_string(getpid()));
+      filesystem::create_directories(root / "components");
+    }
+
+    void TearDown() override {
+      filesystem::remove_all(root);
+    }
+
+    string write(const string &filename, const string &content) {
+      ofstream(root / filename, ios::trunc | ios::binary) << content;
+      return (root / filename).string();
+    }
+};
+
+TEST_F(IncludeStoreTest, escape) {
+  for (const string &text : { string(""), string("<div class=\"row\">\n\t</div>"),
+    string("back\\slash, caf\xc3\xa9 /path"), string("\x01\x1f\x7f\b\f\r", 6) })
+    EXPECT_EQ(IncludeStore::Escape(text), nlohmann::json(text).dump());
+}
+
+TEST_F(IncludeStoreTest, caches_until_invalidated) {
+  IncludeStore store;
+  auto path = write("components/row.html", "<tr>\"row\"</tr>");
+
+  auto escaped = store.get(path);
+  EXPECT_EQ(*escaped, "\"<tr>\\\"row\\\"</tr>\"");
+  EXPECT_EQ(store.get(path), escaped);
+  EXPECT_EQ(store.size(), 1u);
+
+  // Without an invalidation, changes go unnoticed:
+  write("components/row.html", "<tr></tr>");
+  EXPECT_EQ(*store.get(path), "\"<tr>\\\"row\\\"</tr>\"");
+
+  store.invalidate(path);
+  EXPECT_EQ(*store.get(path), "\"<tr></tr>\"");
+
+  // Directories invalidate everything inside them:
+  auto other = write("components/cell.html", "<td></td>");
+  store.get(other);
+  EXPECT_EQ(store.size(), 2u);
+  store.invalidate((root / "components").string());
+  EXPECT_EQ(store.size(), 0u);
+}
+
+TEST_F(IncludeStoreTest, large_files_and_content) {
+  IncludeStore store;
+
+  string large(IncludeStore::MinMappedSize+1, 'x');
+  large[10] = '\n';
+  EXPECT_EQ(*store.get(write("large.html", large)), nlohmann::json(large).dump());
+
+  // Provided content is used instead of the file's:
+  EXPECT_EQ(*store.get((root / "embedded.html").string(), "<p>\"embedded\"</p>"), 
+    "\"<p>\\\"embedded\\\"</p>\"");
+  EXPECT_EQ(store.size(), 2u);
+}
+
+TEST_F(IncludeStoreTest, concurrent) {
+  IncludeStore store;
+  vector<string> paths;
+  for (unsigned int i = 0; i < 8; i++)
+    paths.push_back(write("file"+to_string(i)+".html", "file "+to_string(i)));
+
+  vector<thread> threads;
+  atomic<unsigned int> mismatches(0);
+  for (unsigned int i = 0; i < 8; i++)
+    threads.emplace_back([&, i]() {
+      for (unsigned int j = 0; j < 500; j++) {
+        auto n = (i+j) % paths.size();
+        if (*store.get(paths[n]) != "\"file "+to_string(n)+"\"") mismatches++;
+        if (j % 50 == 0) store.invalidate(paths[i]);
+      }
+    });
+
+  for (auto &t : threads) t.join();
+  EXPECT_EQ(mismatches, 0u);
+}
@@ -35,6 +35,7 @@ class LoggerConcurrencyEnvironment : public PrailsEnvironment {
   public:
     void SetUp() override {
       config = make_unique<ConfigParser>(string(TESTS_CONFIG_FILE));
+      config->port(0);
       // We override these here,to make this test meaningful:
       config->threads(8);
       config->log_level("debug");
@@ -99,7 +100,7 @@ TEST(LoggerConcurrency, ab_log_a_visit) {
   string output;
   tie(return_code, output) = prails::utilities::capture_system(fmt::format(
     "{} -d -q -S -n {} -k -c {} http://localhost:{}/log-a-visit",
-    abPath, abRequests, abThreads, 8081));
+    abPath, abRequests, abThreads, prails_env->port()));
 
   smatch parts;
   string complete_requests;
@@ -0,0 +1,93 @@
+#include <thread>
+#include <vector>
+
+#include "metrics.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+TEST(Metrics, BucketIndex) {
+  using Histogram = Metrics::Histogram;
+
+  for (uint64_t i = 0; i < 16; i++) EXPECT_EQ(Histogram::BucketIndex(i), i);
+
+  // Every value falls below the upper bound of its bucket, and at or above the
+  // upper bound of the bucket before it:
+  for (uint64_t value : {16ul, 17ul, 18ul, 31ul, 32ul, 1000ul, 123456ul, 
+    (1ul << 30) + 12345ul}) {
+    size_t index = Histogram::BucketIndex(value);
+    EXPECT_LT(value, Histogram::BucketUpperBound(index));
+    EXPECT_GE(value, Histogram::BucketUpperBound(index-1));
+    // And, no bucket is more than 12.5% wider than its lower bound:
+    EXPECT_LE(Histogram::BucketUpperBound(index) - Histogram::BucketUpperBound(index-1),
+      Histogram::BucketUpperBound(index-1) / 8 + 1);
+  }
+
+  EXPECT_EQ(Histogram::BucketIndex(UINT64_MAX), Histogram::NumBuckets-1);
+}
+
+TEST(Metrics, Counter) {
+  auto &counter = Metrics::GetCounter("test_counter_total", "A test counter.");
+  EXPECT_EQ(&counter, &Metrics::GetCounter("test_counter_total", "A test counter."));
+
+  vector<thread> threads;
+  for (unsigned int i = 0; i < 8; i++)
+    threads.emplace_back([&counter] {
+      for (unsigned int j = 0; j < 10000; j++) counter.increment();
+    });
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(counter.value(), 80000);
+}
+
+TEST(Metrics, Histogram) {
+  auto &histogram = Metrics::GetHistogram("test_latency_seconds", "A test histogram.");
+  histogram.observe(50);
+  histogram.observe(700);
+  histogram.observe(3000000);
+
+  EXPECT_EQ(histogram.count(), 3);
+  EXPECT_EQ(histogram.sum(), 3000750);
+
+  {
+    Metrics::ScopedTimer timer(histogram);
+  }
+  EXPECT_EQ(histogram.count(), 4);
+}
+
+TEST(Metrics, Scrape) {
+  auto &route = Metrics::GetRoute("Tests", "index");
+  route.record(200, 50);
+  route.record(200, 700);
+  route.record(404, 300);
+  route.record(1000, 300);
+
+  Metrics::GetCounter("test_scrape_total{kind=\"a\"}", "Scraped things.").increment(2);
+  Metrics::GetCounter("test_scrape_total{kind=\"b\"}", "Scraped things.").increment(3);
+  Metrics::SetGauge("test_gauge", "A test gauge.", [] { return 1.5; });
+
+  string scraped = Metrics::Scrape();
+
+  auto contains = [&scraped](const string &s) { 
+    return scraped.find(s) != string::npos; 
+  };
+
+  EXPECT_TRUE(contains("# TYPE test_scrape_total counter\n"
+    "test_scrape_total{kind=\"a\"} 2\n"
+    "test_scrape_total{kind=\"b\"} 3\n"));
+  EXPECT_TRUE(contains("# TYPE test_gauge gauge\ntest_gauge 1.5\n"));
+  EXPECT_TRUE(contains("# TYPE prails_request_duration_seconds histogram\n"));
+
+  string labels = "controller=\"Tests\",action=\"index\",status=\"200\"";
+  EXPECT_TRUE(contains("prails_request_duration_seconds_bucket{"+labels+
+    ",le=\"0.0001\"} 1\n"));
+  EXPECT_TRUE(contains("prails_request_duration_seconds_bucket{"+labels+
+    ",le=\"0.001\"} 2\n"));
+  EXPECT_TRUE(contains("prails_request_duration_seconds_bucket{"+labels+
+    ",le=\"+Inf\"} 2\n"));
+  EXPECT_TRUE(contains("prails_request_duration_seconds_count{"+labels+"} 2\n"));
+  EXPECT_TRUE(contains("prails_request_duration_seconds_count{"
+    "controller=\"Tests\",action=\"index\",status=\"404\"} 1\n"));
+  EXPECT_FALSE(contains("status=\"1000\""));
+}
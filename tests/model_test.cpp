@@ -12,7 +12,7 @@ PSYM_MODEL(TimeModel)
 PSYM_MODEL(ValidationModel)
 PSYM_MODEL(TesterModel)
 
-class TesterModelTest : public PrailsControllerTest {
+class TesterModelTest : public PrailsDatabaseTest {
  public:
    static string driver;
 
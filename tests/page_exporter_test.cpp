@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <filesystem>
+
+#include "page_exporter.hpp"
+
+using namespace std;
+
+TEST(PageExporter, url_to_path) {
+  EXPECT_EQ(PageExporter::UrlToPath("/"), "index.html");
+  EXPECT_EQ(PageExporter::UrlToPath("/tasks"), "tasks/index.html");
+  EXPECT_EQ(PageExporter::UrlToPath("/tasks/"), "tasks/index.html");
+  EXPECT_EQ(PageExporter::UrlToPath("/tasks/1"), "tasks/1/index.html");
+  EXPECT_EQ(PageExporter::UrlToPath("/feed.xml"), "feed.xml");
+  EXPECT_EQ(PageExporter::UrlToPath("/js/app.js"), "js/app.js");
+
+  EXPECT_THROW(PageExporter::UrlToPath("tasks"), invalid_argument);
+  EXPECT_THROW(PageExporter::UrlToPath("/tasks?page=2"), invalid_argument);
+  EXPECT_THROW(PageExporter::UrlToPath("/../etc/passwd"), invalid_argument);
+  EXPECT_THROW(PageExporter::UrlToPath("/tasks/./1"), invalid_argument);
+  EXPECT_THROW(PageExporter::UrlToPath("//tasks"), invalid_argument);
+}
+
+TEST(PageExporter, read_urls) {
+  auto dir = filesystem::temp_directory_path();
+
+  auto list_path = (dir / "page_exporter_test.txt").string();
+  ofstream(list_path) << "# Our pages\n/\n  /tasks  \n\n/tasks/1\n";
+  EXPECT_EQ(PageExporter::ReadUrls(list_path),
+    vector<string>({"/", "/tasks", "/tasks/1"}));
+
+  auto sitemap_path = (dir / "page_exporter_test.xml").string();
+  ofstream(sitemap_path) <<
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<urlset xmlns=\"http://www.sitemaps.org/schemas/sitemap/0.9\">\n"
+    "  <url><loc>https://example.com/</loc></url>\n"
+    "  <url><loc>https://example.com</loc></url>\n"
+    "  <url>\n    <loc> https://example.com/tasks </loc>\n"
+    "    <lastmod>2020-01-01</lastmod>\n  </url>\n"
+    "  <url><loc>http://example.com:8080/a&amp;b</loc></url>\n"
+    "</urlset>\n";
+  EXPECT_EQ(PageExporter::ReadUrls(sitemap_path),
+    vector<string>({"/", "/", "/tasks", "/a&b"}));
+
+  filesystem::remove(list_path);
+  filesystem::remove(sitemap_path);
+
+  EXPECT_THROW(PageExporter::ReadUrls(list_path), invalid_argument);
+}
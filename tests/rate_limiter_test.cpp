@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+
+#include "rate_limiter.hpp"
+
+using namespace std;
+
+TEST(RateLimiter, token_bucket) {
+  RateLimiter limiter(2, 3, 100);
+  auto now = chrono::steady_clock::now();
+
+  // A new client can burst:
+  EXPECT_TRUE(limiter.allow("10.0.0.1", now));
+  EXPECT_TRUE(limiter.allow("10.0.0.1", now));
+  EXPECT_TRUE(limiter.allow("10.0.0.1", now));
+  EXPECT_FALSE(limiter.allow("10.0.0.1", now));
+
+  // Other clients have their own bucket:
+  EXPECT_TRUE(limiter.allow("10.0.0.2", now));
+
+  // At 2 a second, we regain a token in 500ms:
+  EXPECT_FALSE(limiter.allow("10.0.0.1", now+chrono::milliseconds(400)));
+  EXPECT_TRUE(limiter.allow("10.0.0.1", now+chrono::milliseconds(500)));
+  EXPECT_FALSE(limiter.allow("10.0.0.1", now+chrono::milliseconds(500)));
+
+  // Buckets never hold more than the burst:
+  auto later = now+chrono::hours(1);
+  for (unsigned int i = 0; i < 3; i++) EXPECT_TRUE(limiter.allow("10.0.0.1", later));
+  EXPECT_FALSE(limiter.allow("10.0.0.1", later));
+}
+
+TEST(RateLimiter, bounded_clients) {
+  RateLimiter limiter(1, 1, RateLimiter::NumShards * 4);
+  auto now = chrono::steady_clock::now();
+
+  for (unsigned int i = 0; i < 10000; i++)
+    limiter.allow("client-"+to_string(i), now);
+
+  EXPECT_LE(limiter.size(), RateLimiter::NumShards * 4);
+}
+
+TEST(RateLimiter, evicts_least_recently_seen) {
+  // With a single client per shard, any new client in that shard evicts the 
+  // one before it:
+  RateLimiter limiter(1, 1, RateLimiter::NumShards);
+  auto now = chrono::steady_clock::now();
+
+  EXPECT_TRUE(limiter.allow("a", now));
+  EXPECT_FALSE(limiter.allow("a", now));
+
+  // Find another key that lands in the same shard as "a":
+  string other;
+  for (unsigned int i = 0; other.empty(); i++)
+    if ((hash<string>()("b"+to_string(i)) % RateLimiter::NumShards) == 
+      (hash<string>()("a") % RateLimiter::NumShards))
+      other = "b"+to_string(i);
+
+  EXPECT_TRUE(limiter.allow(other, now));
+
+  // "a" was forgotten, and starts over with a full bucket:
+  EXPECT_TRUE(limiter.allow("a", now));
+}
+
+TEST(RateLimiter, invalid_limits) {
+  EXPECT_THROW(RateLimiter(0, 1, 10), invalid_argument);
+  EXPECT_THROW(RateLimiter(1, 0, 10), invalid_argument);
+}
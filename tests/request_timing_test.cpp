@@ -0,0 +1,89 @@
+#include <regex>
+#include <thread>
+
+#include "request_timing.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+TEST(RequestTiming, no_current_timing) {
+  EXPECT_EQ(RequestTiming::Current(), nullptr);
+
+  // This should be harmless:
+  RequestTiming::Timer timer(RequestTiming::Database);
+}
+
+TEST(RequestTiming, scope) {
+  RequestTiming outer, inner;
+  {
+    RequestTiming::Scope outer_scope(outer);
+    EXPECT_EQ(RequestTiming::Current(), &outer);
+    {
+      RequestTiming::Scope inner_scope(inner);
+      EXPECT_EQ(RequestTiming::Current(), &inner);
+    }
+    EXPECT_EQ(RequestTiming::Current(), &outer);
+
+    // Timings are per-thread:
+    thread([] { EXPECT_EQ(RequestTiming::Current(), nullptr); }).join();
+  }
+  EXPECT_EQ(RequestTiming::Current(), nullptr);
+}
+
+TEST(RequestTiming, timers) {
+  RequestTiming timing;
+  RequestTiming::Scope scope(timing);
+
+  for (unsigned int i = 0; i < 3; i++) {
+    RequestTiming::Timer query(RequestTiming::Database);
+    // Nested timers of the same phase, aren't counted twice:
+    RequestTiming::Timer nested(RequestTiming::Database);
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+
+  {
+    RequestTiming::Timer render(RequestTiming::Rendering);
+  }
+
+  EXPECT_EQ(timing.count(RequestTiming::Database), 3);
+  EXPECT_GE(timing.duration(RequestTiming::Database), chrono::milliseconds(3));
+  EXPECT_EQ(timing.count(RequestTiming::Rendering), 1);
+  EXPECT_EQ(timing.count(RequestTiming::Authorization), 0);
+
+  string header = timing.header();
+  EXPECT_TRUE(regex_match(header, regex(
+    "db;dur=[\\d\\.]+;desc=\"Database \\(3 queries\\)\", "
+    "render;dur=[\\d\\.]+;desc=\"Rendering\", "
+    "total;dur=[\\d\\.]+"))) << header;
+}
+
+TEST(RequestTiming, captured_queries) {
+  RequestTiming timing;
+  RequestTiming::Scope scope(timing);
+
+  // Nothing is kept, until we ask for it:
+  RequestTiming::LogQuery("select 1");
+  EXPECT_TRUE(timing.queries().empty());
+
+  timing.capture_queries(true);
+
+  {
+    RequestTiming::Timer db(RequestTiming::Database);
+    RequestTiming::LogQuery("select * from tasks");
+    this_thread::sleep_for(chrono::milliseconds(2));
+    RequestTiming::QueryRows(3);
+  }
+
+  {
+    RequestTiming::Timer db(RequestTiming::Database);
+    RequestTiming::LogQuery("delete from tasks");
+  }
+
+  ASSERT_EQ(timing.queries().size(), 2);
+  EXPECT_EQ(timing.queries()[0].statement, "select * from tasks");
+  EXPECT_GE(timing.queries()[0].duration, chrono::milliseconds(2));
+  EXPECT_EQ(*timing.queries()[0].rows, 3);
+  EXPECT_EQ(timing.queries()[1].statement, "delete from tasks");
+  EXPECT_FALSE(timing.queries()[1].rows);
+}
@@ -48,7 +48,7 @@ TEST_F(TaskControllerFixture, index) {
 
   EXPECT_EQ(Task::Count("select count(*) from tasks"), 10);
 
-  auto res = browser().Get("/tasks");
+  auto res = client().Get("/tasks");
 
   ASSERT_EQ(res->status, 200);
 
@@ -77,7 +77,7 @@ TEST_F(TaskControllerFixture, read) {
   Task task(default_task);
   EXPECT_NO_THROW(task.save());
 
-  auto res = browser().Get(fmt::format("/tasks/{}", *task.id()).c_str());
+  auto res = client().Get(fmt::format("/tasks/{}", *task.id()));
 
   ASSERT_EQ(res->status, 200);
 
@@ -98,7 +98,7 @@ TEST_F(TaskControllerFixture, create) {
 
   EXPECT_EQ(Task::Count("select count(*) from tasks"), 0);
 
-  auto res = browser().Post("/tasks", 
+  auto res = client().Post("/tasks", 
     "name=Test+Task&description=lorem+ipsum+sit+dolor&active=1",
     "application/x-www-form-urlencoded");
 
@@ -126,8 +126,8 @@ TEST_F(TaskControllerFixture, update) {
   Task task(default_task);
   EXPECT_NO_THROW(task.save());
 
-  auto res = browser().Put(
-    fmt::format("/tasks/{}", *task.id()).c_str(), 
+  auto res = client().Put(
+    fmt::format("/tasks/{}", *task.id()), 
     "name=Updated+Task&description=updated+lorem+ipsum+sit+dolor&active=0",
     "application/x-www-form-urlencoded");
 
@@ -161,7 +161,7 @@ TEST_F(TaskControllerFixture, del) {
 
   EXPECT_EQ(Task::Count("select count(*) from tasks"), 1);
 
-  auto res = browser().Delete(fmt::format("/tasks/{}", *task.id()).c_str());
+  auto res = client().Delete(fmt::format("/tasks/{}", *task.id()));
 
   ASSERT_EQ(res->status, 200);
 
@@ -182,7 +182,7 @@ TEST_F(TaskControllerFixture, multiple_update) {
   auto tasks = Task::Select("select id from tasks");
   EXPECT_EQ(tasks.size(), 4);
 
-  auto res = browser().Post("/tasks/multiple-update", fmt::format(
+  auto res = client().Post("/tasks/multiple-update", fmt::format(
     "ids%5B%5D={}&ids%5B%5D={}&request%5Bdescription%5D=New+Description",
     *tasks[1].id(), *tasks[3].id() ), "application/x-www-form-urlencoded");
 
@@ -222,7 +222,7 @@ TEST_F(TaskControllerFixture, multiple_delete) {
   auto tasks = Task::Select("select id from tasks");
   EXPECT_EQ(tasks.size(), 4);
 
-  auto res = browser().Post("/tasks/multiple-delete", fmt::format(
+  auto res = client().Post("/tasks/multiple-delete", fmt::format(
     "ids%5B%5D={}&ids%5B%5D={}&request%5Bdescription%5D=New+Description",
     *tasks[1].id(), *tasks[3].id() ), "application/x-www-form-urlencoded");
 
@@ -21,3 +21,71 @@ TEST(Server, ExtToMime) {
   ASSERT_TRUE(Server::ExtToMime("html").has_value());
   ASSERT_EQ("text/html", *Server::ExtToMime("html"));
 }
+
+TEST(Server, AcceptsGzip) {
+  EXPECT_FALSE(Server::AcceptsGzip(nullopt));
+  EXPECT_FALSE(Server::AcceptsGzip("identity"));
+  EXPECT_FALSE(Server::AcceptsGzip("deflate, br"));
+  EXPECT_FALSE(Server::AcceptsGzip("gzip;q=0, deflate"));
+  EXPECT_FALSE(Server::AcceptsGzip("gzip; q=0.0"));
+
+  EXPECT_TRUE(Server::AcceptsGzip("gzip"));
+  EXPECT_TRUE(Server::AcceptsGzip("GZIP"));
+  EXPECT_TRUE(Server::AcceptsGzip("gzip, deflate, br"));
+  EXPECT_TRUE(Server::AcceptsGzip("deflate, gzip;q=0.5"));
+  EXPECT_TRUE(Server::AcceptsGzip("*"));
+}
+
+TEST(Server, IsCompressible) {
+  using Pistache::Http::Mime::MediaType;
+
+  EXPECT_TRUE(Server::IsCompressible(MediaType::fromString("text/html")));
+  EXPECT_TRUE(Server::IsCompressible(MediaType::fromString("text/css")));
+  EXPECT_TRUE(Server::IsCompressible(MediaType::fromString("application/javascript")));
+  EXPECT_TRUE(Server::IsCompressible(MediaType::fromString("application/json")));
+  EXPECT_TRUE(Server::IsCompressible(MediaType::fromString("image/svg+xml")));
+  EXPECT_TRUE(Server::IsCompressible(MediaType::fromString("application/atom+xml")));
+
+  EXPECT_FALSE(Server::IsCompressible(MediaType::fromString("image/png")));
+  EXPECT_FALSE(Server::IsCompressible(MediaType::fromString("application/zip")));
+  EXPECT_FALSE(Server::IsCompressible(MediaType::fromString("video/mp4")));
+}
+
+TEST(Server, ParseRanges) {
+  typedef vector<pair<size_t, size_t>> Ranges;
+
+  EXPECT_EQ(Server::ParseRanges("bytes=0-99", 1000), Ranges({{0, 99}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=900-", 1000), Ranges({{900, 999}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=-100", 1000), Ranges({{900, 999}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=-2000", 1000), Ranges({{0, 999}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=500-5000", 1000), Ranges({{500, 999}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=0-0, 10-19", 1000), 
+    Ranges({{0, 0}, {10, 19}}));
+
+  // Unsatisfiable:
+  EXPECT_EQ(Server::ParseRanges("bytes=1000-", 1000), Ranges());
+  EXPECT_EQ(Server::ParseRanges("bytes=-0", 1000), Ranges());
+  EXPECT_EQ(Server::ParseRanges("bytes=0-10", 0), Ranges());
+
+  // Malformed ranges are ignored, and the whole resource is sent:
+  EXPECT_FALSE(Server::ParseRanges("bytes=", 1000).has_value());
+  EXPECT_FALSE(Server::ParseRanges("bytes=-", 1000).has_value());
+  EXPECT_FALSE(Server::ParseRanges("bytes=10-5", 1000).has_value());
+  EXPECT_FALSE(Server::ParseRanges("bytes=a-b", 1000).has_value());
+  EXPECT_FALSE(Server::ParseRanges("items=0-10", 1000).has_value());
+  EXPECT_FALSE(Server::ParseRanges("bytes=0-99999999999999999999999", 1000).has_value());
+
+  string many = "bytes=0-0";
+  for (unsigned int i = 1; i <= Server::MaxRanges; i++) many += ","+to_string(i)+"-"+to_string(i);
+  EXPECT_FALSE(Server::ParseRanges(many, 1000).has_value());
+
+  // Overlapping and adjacent ranges are coalesced:
+  EXPECT_EQ(Server::ParseRanges("bytes=100-199, 0-9, 5-19, 20-29", 1000), 
+    Ranges({{0, 29}, {100, 199}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=0-, 0-, -500", 1000), Ranges({{0, 999}}));
+  EXPECT_EQ(Server::ParseRanges("bytes=10-19, 12-15", 1000), Ranges({{10, 19}}));
+
+  // Ranges aren't bounded in length, save by the file:
+  EXPECT_EQ(Server::ParseRanges("bytes=0-, 100-", 64*1024*1024), 
+    Ranges({{0, 64*1024*1024-1}}));
+}
@@ -0,0 +1,245 @@
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "static_cache.hpp"
+#include "file_watcher.hpp"
+#include "utilities.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace prails::utilities;
+
+string gunzip(const string &compressed) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  inflateInit2(&stream, 15+16);
+
+  string ret(4096, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+  stream.avail_in = compressed.size();
+  stream.next_out = reinterpret_cast<Bytef *>(ret.data());
+  stream.avail_out = ret.size();
+  inflate(&stream, Z_FINISH);
+  ret.resize(stream.total_out);
+  inflateEnd(&stream);
+
+  return ret;
+}
+
+class StaticCacheFixture : public ::testing::Test {
+  protected:
+    string root;
+
+    void SetUp() override {
+      root = filesystem::temp_directory_path().string()+"/static_cache_test_"+
+        to_string(getpid());
+      filesystem::create_directories(root+"/js");
+    }
+
+    void TearDown() override {
+      filesystem::remove_all(root);
+    }
+
+    string write(const string &name, const string &content) {
+      string path = root+"/"+name;
+      ofstream out(path);
+      out << content;
+      out.close();
+      return path;
+    }
+};
+
+TEST_F(StaticCacheFixture, load_and_find) {
+  StaticCache cache(4096, 1024);
+  string path = write("js/app.js", "var a = 1;");
+
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+
+  auto loaded = cache.load("/js/app.js", path, Pistache::Http::Mime::MediaType());
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_TRUE(loaded->is_resident);
+  EXPECT_EQ(loaded->content, "var a = 1;");
+  EXPECT_EQ(loaded->size, 10);
+  EXPECT_FALSE(loaded->etag.empty());
+  EXPECT_EQ(loaded->last_modified, time_to_http_date(loaded->mtime));
+
+  auto found = cache.find("/js/app.js");
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(found->content, "var a = 1;");
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST_F(StaticCacheFixture, large_files_arent_resident) {
+  StaticCache cache(4096, 4);
+  string path = write("large.txt", "0123456789");
+
+  auto entry = cache.load("/large.txt", path, Pistache::Http::Mime::MediaType());
+  ASSERT_NE(entry, nullptr);
+  EXPECT_FALSE(entry->is_resident);
+  EXPECT_TRUE(entry->content.empty());
+  EXPECT_NE(cache.find("/large.txt"), nullptr);
+}
+
+TEST_F(StaticCacheFixture, evicts_least_recently_used) {
+  string a = write("a.txt", string(600, 'a'));
+  string b = write("b.txt", string(600, 'b'));
+  string c = write("c.txt", string(600, 'c'));
+
+  StaticCache cache(2000, 1024);
+  cache.load("/a.txt", a, Pistache::Http::Mime::MediaType());
+  cache.load("/b.txt", b, Pistache::Http::Mime::MediaType());
+  EXPECT_NE(cache.find("/a.txt"), nullptr);
+  cache.load("/c.txt", c, Pistache::Http::Mime::MediaType());
+
+  EXPECT_NE(cache.find("/a.txt"), nullptr);
+  EXPECT_EQ(cache.find("/b.txt"), nullptr);
+  EXPECT_NE(cache.find("/c.txt"), nullptr);
+  EXPECT_LE(cache.bytes(), 2000);
+}
+
+TEST_F(StaticCacheFixture, invalidate) {
+  StaticCache cache(4096, 1024);
+  string path = write("js/app.js", "var a = 1;");
+  cache.load("/js/app.js", path, Pistache::Http::Mime::MediaType());
+
+  cache.invalidate(root+"/js");
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+  EXPECT_EQ(cache.bytes(), 0);
+}
+
+TEST_F(StaticCacheFixture, is_not_modified) {
+  StaticCache cache(4096, 1024);
+  auto entry = cache.load("/a.txt", write("a.txt", "a"), Pistache::Http::Mime::MediaType());
+  ASSERT_NE(entry, nullptr);
+
+  EXPECT_FALSE(entry->is_not_modified(nullopt, nullopt));
+  EXPECT_TRUE(entry->is_not_modified(entry->etag, nullopt));
+  EXPECT_TRUE(entry->is_not_modified("\"other\", W/"+entry->etag, nullopt));
+  EXPECT_TRUE(entry->is_not_modified("*", nullopt));
+  EXPECT_FALSE(entry->is_not_modified("\"other\"", nullopt));
+
+  EXPECT_TRUE(entry->is_not_modified(nullopt, time_to_http_date(entry->mtime)));
+  EXPECT_FALSE(entry->is_not_modified(nullopt, time_to_http_date(entry->mtime-1)));
+  EXPECT_FALSE(entry->is_not_modified(nullopt, "not a date"));
+
+  // If-None-Match wins, when both are supplied:
+  EXPECT_FALSE(entry->is_not_modified("\"other\"", time_to_http_date(entry->mtime)));
+}
+
+TEST_F(StaticCacheFixture, gzip) {
+  string content;
+  for (unsigned int i = 0; i < 100; i++) content += "function a() { return 1; }\n";
+
+  auto compressed = StaticCache::Gzip(content);
+  ASSERT_TRUE(compressed.has_value());
+  EXPECT_LT(compressed->size(), content.size());
+  EXPECT_EQ(gunzip(*compressed), content);
+}
+
+TEST_F(StaticCacheFixture, compresses_once) {
+  string content;
+  for (unsigned int i = 0; i < 100; i++) content += "function a() { return 1; }\n";
+
+  StaticCache cache(65536, 65536);
+  string path = write("js/app.js", content);
+
+  auto uncompressible = cache.load("/js/app.js", path, 
+    Pistache::Http::Mime::MediaType());
+  EXPECT_FALSE(uncompressible->has_gzip());
+
+  auto entry = cache.load("/js/app.js", path, Pistache::Http::Mime::MediaType(), 
+    nullopt, true);
+  ASSERT_TRUE(entry->has_gzip());
+  EXPECT_EQ(gunzip(entry->gzip_content), content);
+  EXPECT_NE(entry->gzip_etag, entry->etag);
+  EXPECT_TRUE(entry->is_not_modified(entry->gzip_etag, nullopt));
+
+  // Compressing something that doesn't get smaller, isn't worth keeping:
+  auto tiny = cache.load("/tiny.js", write("tiny.js", "a"), 
+    Pistache::Http::Mime::MediaType(), nullopt, true);
+  EXPECT_FALSE(tiny->has_gzip());
+
+  // Entries that we won't be keeping, aren't compressed at all:
+  StaticCache disabled_cache(0, 65536);
+  EXPECT_FALSE(disabled_cache.load("/js/app.js", path, 
+    Pistache::Http::Mime::MediaType(), nullopt, true)->has_gzip());
+
+  StaticCache small_cache(content.size(), 65536);
+  EXPECT_FALSE(small_cache.load("/js/app.js", path, 
+    Pistache::Http::Mime::MediaType(), nullopt, true)->has_gzip());
+}
+
+TEST_F(StaticCacheFixture, sidecars) {
+  StaticCache cache(4096, 1024);
+  string path = write("js/app.js", "var a = 1;");
+  string sidecar = write("js/app.js.gz", "not-really-gzip");
+
+  auto entry = cache.load("/js/app.js", path, Pistache::Http::Mime::MediaType(), 
+    sidecar, true);
+  ASSERT_TRUE(entry->has_gzip());
+  EXPECT_EQ(entry->gzip_content, "not-really-gzip");
+
+  // Changes to the sidecar, invalidate the file it accompanies:
+  cache.invalidate(sidecar);
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+
+  StaticCache tiny_cache(4096, 4);
+  auto large = tiny_cache.load("/js/app.js", path, Pistache::Http::Mime::MediaType(), 
+    sidecar, true);
+  EXPECT_FALSE(large->is_resident);
+  EXPECT_EQ(large->gzip_path, sidecar);
+  EXPECT_TRUE(large->gzip_content.empty());
+}
+
+TEST_F(StaticCacheFixture, prepare_and_complete) {
+  StaticCache cache(4096, 1024);
+  string path = write("js/app.js", "var a = 1;");
+
+  auto pending = cache.prepare("/js/app.js", path, Pistache::Http::Mime::MediaType());
+  ASSERT_TRUE(pending.has_value());
+  EXPECT_TRUE(pending->entry->is_resident);
+  EXPECT_EQ(pending->entry->size, 10);
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+
+  // Content that doesn't match what was stat()'d, isn't served or cached:
+  EXPECT_EQ(cache.complete(*pending, "var a"), nullptr);
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+
+  auto entry = cache.complete(*pending, "var a = 1;");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->content, "var a = 1;");
+  EXPECT_NE(cache.find("/js/app.js"), nullptr);
+
+  // Invalidations that arrive during the read, prevent the result from being cached:
+  pending = cache.prepare("/js/app.js", path, Pistache::Http::Mime::MediaType());
+  cache.invalidate(path);
+  EXPECT_NE(cache.complete(*pending, "var a = 1;"), nullptr);
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+
+  EXPECT_FALSE(cache.prepare("/missing.js", root+"/missing.js", 
+    Pistache::Http::Mime::MediaType()).has_value());
+}
+
+TEST_F(StaticCacheFixture, file_watcher_invalidates) {
+  StaticCache cache(4096, 1024);
+  string path = write("js/app.js", "var a = 1;");
+  cache.load("/js/app.js", path, Pistache::Http::Mime::MediaType());
+
+  FileWatcher watcher(root);
+  watcher.subscribe([&cache](const string &changed) { cache.invalidate(changed); });
+  watcher.start();
+
+  write("js/app.js", "var a = 2;");
+
+  for (unsigned int i = 0; (i < 100) && cache.find("/js/app.js"); i++)
+    this_thread::sleep_for(chrono::milliseconds(10));
+
+  EXPECT_EQ(cache.find("/js/app.js"), nullptr);
+
+  watcher.stop();
+}
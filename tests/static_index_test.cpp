@@ -0,0 +1,104 @@
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include "static_index.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+class StaticIndexFixture : public ::testing::Test {
+  protected:
+    string root;
+    unsigned int resolved = 0;
+
+    void SetUp() override {
+      root = filesystem::temp_directory_path().string()+"/static_index_test_"+
+        to_string(getpid());
+      filesystem::create_directories(root+"/js");
+      filesystem::create_directories(root+"/css");
+      write("index.html");
+      write("js/app.js");
+      write("css/site.css");
+    }
+
+    void TearDown() override {
+      filesystem::remove_all(root);
+    }
+
+    StaticIndex index() {
+      return StaticIndex(root, [this](const string &) {
+        resolved++;
+        return Pistache::Http::Mime::MediaType();
+      });
+    }
+
+    void write(const string &name) {
+      ofstream out(root+"/"+name);
+      out << name;
+      out.close();
+      filesystem::permissions(root+"/"+name, filesystem::perms::owner_read |
+        filesystem::perms::owner_write | filesystem::perms::group_read |
+        filesystem::perms::others_read);
+    }
+};
+
+TEST_F(StaticIndexFixture, rebuild) {
+  auto static_index = index();
+  static_index.rebuild();
+
+  EXPECT_EQ(static_index.size(), 3);
+  EXPECT_EQ(resolved, 3);
+
+  ASSERT_NE(static_index.find("/js/app.js"), nullptr);
+  EXPECT_EQ(static_index.find("/js/app.js")->local_path, root+"/js/app.js");
+  EXPECT_NE(static_index.find("/index.html"), nullptr);
+  EXPECT_NE(static_index.find("/css/site.css"), nullptr);
+
+  EXPECT_EQ(static_index.find("/"), nullptr);
+  EXPECT_EQ(static_index.find("/js"), nullptr);
+  EXPECT_EQ(static_index.find("/missing.js"), nullptr);
+  EXPECT_EQ(static_index.find("/js/../index.html"), nullptr);
+  EXPECT_EQ(static_index.find("//index.html"), nullptr);
+}
+
+TEST_F(StaticIndexFixture, ignores_links_and_unsafe_names) {
+  filesystem::create_symlink("/etc/passwd", root+"/passwd");
+  filesystem::create_directory_symlink("/etc", root+"/etc");
+  write("bad$name.js");
+
+  auto static_index = index();
+  static_index.rebuild();
+
+  EXPECT_EQ(static_index.size(), 3);
+  EXPECT_EQ(static_index.find("/passwd"), nullptr);
+  EXPECT_EQ(static_index.find("/etc/passwd"), nullptr);
+  EXPECT_EQ(static_index.find("/bad$name.js"), nullptr);
+}
+
+TEST_F(StaticIndexFixture, update) {
+  auto static_index = index();
+  static_index.rebuild();
+
+  write("js/vendor.js");
+  static_index.update(root+"/js/vendor.js");
+  EXPECT_NE(static_index.find("/js/vendor.js"), nullptr);
+  EXPECT_EQ(static_index.size(), 4);
+
+  filesystem::create_directories(root+"/img/icons");
+  write("img/icons/logo.png");
+  static_index.update(root+"/img");
+  EXPECT_NE(static_index.find("/img/icons/logo.png"), nullptr);
+
+  filesystem::remove_all(root+"/js");
+  static_index.update(root+"/js");
+  EXPECT_EQ(static_index.find("/js/app.js"), nullptr);
+  EXPECT_EQ(static_index.find("/js/vendor.js"), nullptr);
+  EXPECT_EQ(static_index.size(), 3);
+
+  filesystem::remove(root+"/index.html");
+  static_index.update(root);
+  EXPECT_EQ(static_index.find("/index.html"), nullptr);
+  EXPECT_EQ(static_index.size(), 2);
+}
@@ -0,0 +1,85 @@
+#include <atomic>
+#include <future>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include "static_reader.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+class StaticReaderFixture : public ::testing::TestWithParam<string> {
+  protected:
+    string root;
+
+    void SetUp() override {
+      root = filesystem::temp_directory_path().string()+"/static_reader_test_"+
+        to_string(getpid());
+      filesystem::create_directories(root);
+    }
+
+    void TearDown() override {
+      filesystem::remove_all(root);
+    }
+
+    string write(const string &name, const string &content) {
+      string path = root+"/"+name;
+      ofstream out(path);
+      out << content;
+      out.close();
+      return path;
+    }
+
+    // Blocks until the reader calls back:
+    optional<string> read(StaticReader &reader, const string &path) {
+      promise<optional<string>> result;
+      reader.read(path, [&result](optional<string> content) { 
+        result.set_value(content); 
+      });
+      return result.get_future().get();
+    }
+};
+
+TEST_P(StaticReaderFixture, read) {
+  auto reader = StaticReader::Create(GetParam(), 2);
+
+  EXPECT_EQ(read(*reader, write("a.txt", "hello")), "hello");
+  EXPECT_EQ(read(*reader, write("empty.txt", "")), "");
+  EXPECT_EQ(read(*reader, root+"/missing.txt"), nullopt);
+
+  string large;
+  for (unsigned int i = 0; i < 100000; i++) large += to_string(i);
+  EXPECT_EQ(read(*reader, write("large.txt", large)), large);
+}
+
+TEST_P(StaticReaderFixture, concurrent_reads) {
+  const unsigned int num_files = 600;
+  for (unsigned int i = 0; i < num_files; i++)
+    write(to_string(i)+".txt", string(i+1, 'a'+(i % 26)));
+
+  atomic<unsigned int> correct(0), completed(0);
+  {
+    auto reader = StaticReader::Create(GetParam(), 4);
+    for (unsigned int i = 0; i < num_files; i++)
+      reader->read(root+"/"+to_string(i)+".txt", [&, i](optional<string> content) {
+        if (content && (*content == string(i+1, 'a'+(i % 26)))) correct++;
+        completed++;
+      });
+    // Readers complete everything that was queued, before they're destroyed.
+  }
+
+  EXPECT_EQ(completed, num_files);
+  EXPECT_EQ(correct, num_files);
+}
+
+INSTANTIATE_TEST_SUITE_P(StaticReader, StaticReaderFixture, 
+  ::testing::Values("threads", "io_uring"));
+
+TEST(StaticReader, Create) {
+  EXPECT_EQ(StaticReader::Create("threads", 1)->name(), "threads");
+  EXPECT_EQ(StaticReader::Create("io_uring", 1)->name(), 
+    (StaticReader::IsUringAvailable()) ? "io_uring" : "threads");
+  EXPECT_THROW(StaticReader::Create("blocking", 1), invalid_argument);
+}
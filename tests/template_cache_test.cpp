@@ -0,0 +1,233 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+#include "template_cache.hpp"
+#include "inja.hpp"
+
+using namespace std;
+
+class TemplateCacheTest : public ::testing::Test {
+  protected:
+    filesystem::path root;
+
+    void SetUp() override {
+      root = filesystem::temp_directory_path() / 
+        ("template_cache_test."+to_string(getpid()));
+      filesystem::create_directories(root);
+      write("view.inja.html", "Hello {{ name }}. {% include \"partial.inja.html\" %}");
+      write("partial.inja.html", "Goodbye {{ name }}.");
+    }
+
+    void TearDown() override {
+      filesystem::remove_all(root);
+    }
+
+    string path(const string &filename) { return (root / filename).string(); }
+
+    // Rewrites the file, with an mtime that's sure to differ from the last:
+    void write(const string &filename, const string &content) {
+      bool exists = filesystem::exists(root / filename);
+      auto mtime = (exists) ? filesystem::last_write_time(root / filename) : 
+        filesystem::file_time_type();
+
+      ofstream(root / filename, ios::trunc) << content;
+
+      if (exists) filesystem::last_write_time(root / filename, mtime+chrono::seconds(1));
+    }
+};
+
+TEST_F(TemplateCacheTest, development_revalidates) {
+  TemplateCache cache(true);
+  nlohmann::json data = { {"name", "Alice"} };
+
+  EXPECT_EQ(cache.render(path("view.inja.html"), data), 
+    "Hello Alice. Goodbye Alice.");
+  EXPECT_EQ(cache.size(), 1u);
+
+  write("view.inja.html", "Hi {{ name }}. {% include \"partial.inja.html\" %}");
+  EXPECT_EQ(cache.render(path("view.inja.html"), data), "Hi Alice. Goodbye Alice.");
+
+  // Includes are revalidated, along with the views that include them:
+  write("partial.inja.html", "Bye {{ name }}.");
+  EXPECT_EQ(cache.render(path("view.inja.html"), data), "Hi Alice. Bye Alice.");
+  EXPECT_EQ(cache.size(), 1u);
+
+  // As are the includes of those includes:
+  write("signature.inja.html", "Love, {{ name }}.");
+  write("partial.inja.html", "Bye. {% include \"signature.inja.html\" %}");
+  EXPECT_EQ(cache.render(path("view.inja.html"), data), 
+    "Hi Alice. Bye. Love, Alice.");
+
+  write("signature.inja.html", "Regards, {{ name }}.");
+  EXPECT_EQ(cache.render(path("view.inja.html"), data), 
+    "Hi Alice. Bye. Regards, Alice.");
+}
+
+TEST_F(TemplateCacheTest, production_never_rereads) {
+  TemplateCache cache(false);
+  nlohmann::json data = { {"name", "Alice"} };
+
+  EXPECT_EQ(cache.render(path("view.inja.html"), data), 
+    "Hello Alice. Goodbye Alice.");
+
+  filesystem::remove(path("view.inja.html"));
+  filesystem::remove(path("partial.inja.html"));
+
+  EXPECT_EQ(cache.render(path("view.inja.html"), { {"name", "Bob"} }),
+    "Hello Bob. Goodbye Bob.");
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_THROW(cache.render(path("view.inja.html"), data), runtime_error);
+}
+
+TEST_F(TemplateCacheTest, setup_and_rendering_path) {
+  TemplateCache cache(false, [](inja::Environment &env) {
+    env.add_callback("rendering", 0, [](inja::Arguments &) { 
+      return TemplateCache::RenderingPath(); 
+    });
+  });
+
+  write("callback.inja.html", "{{ rendering() }}");
+  EXPECT_EQ(cache.render(path("callback.inja.html"), {}), path("callback.inja.html"));
+  EXPECT_EQ(TemplateCache::RenderingPath(), "");
+}
+
+TEST_F(TemplateCacheTest, concurrent_renders) {
+  TemplateCache cache(true);
+  vector<thread> threads;
+  atomic<unsigned int> mismatches(0);
+
+  for (unsigned int i = 0; i < 8; i++)
+    threads.emplace_back([&, i]() {
+      for (unsigned int j = 0; j < 200; j++) {
+        auto name = to_string(i)+"-"+to_string(j);
+        if (cache.render(path("view.inja.html"), { {"name", name} }) != 
+          "Hello "+name+". Goodbye "+name+".")
+          mismatches++;
+      }
+    });
+
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(mismatches, 0u);
+  EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST_F(TemplateCacheTest, streamed_layout) {
+  TemplateCache cache(true, [](inja::Environment &env) {
+    env.add_callback("rendering", 0, [](inja::Arguments &) { 
+      return TemplateCache::RenderingPath(); 
+    });
+  });
+
+  write("layout.inja.html", "<{{ rendering() }}>{{ content }}<{{ rendering() }}>");
+  write("page.inja.html", "[{{ rendering() }}] {% include \"partial.inja.html\" %}");
+
+  nlohmann::json data = { {"name", "Alice"} };
+  EXPECT_EQ(cache.render(path("layout.inja.html"), path("page.inja.html"), data),
+    "<"+path("layout.inja.html")+">["+path("page.inja.html")+"] Goodbye Alice.<"+
+    path("layout.inja.html")+">");
+
+  // The content was streamed, and never stored in the data:
+  EXPECT_FALSE(data.contains("content"));
+  EXPECT_EQ(cache.size(), 2u);
+
+  // Layouts are revalidated, like views:
+  write("layout.inja.html", "({{ content }})");
+  EXPECT_EQ(cache.render(path("layout.inja.html"), path("view.inja.html"), data),
+    "(Hello Alice. Goodbye Alice.)");
+}
+
+TEST_F(TemplateCacheTest, unstreamable_layouts) {
+  TemplateCache cache(false);
+  nlohmann::json data = { {"name", "Alice"} };
+
+  // Content that's printed conditionally, more than once, or by an include, is
+  // rendered into the data instead:
+  for (const auto &layout : {
+    string("{% if content %}<{{ content }}>{% endif %}"),
+    string("<{{ content }}>{{ content }}"),
+    string("<{{ content }}>{% if length(content) > 0 %}{% endif %}"),
+    string("<{{ content }}>{% include \"echo.inja.html\" %}") }) {
+    write("echo.inja.html", "{{ content }}");
+    write("layout.inja.html", layout);
+    cache.clear();
+
+    auto rendered = cache.render(path("layout.inja.html"), path("view.inja.html"),
+      data);
+    EXPECT_EQ(rendered.substr(0, 29), "<Hello Alice. Goodbye Alice.>") << layout;
+    EXPECT_EQ(data["content"], "Hello Alice. Goodbye Alice.") << layout;
+    data.erase("content");
+  }
+}
+
+TEST_F(TemplateCacheTest, nested_renders) {
+  // As the controller's cache() does, a callback renders a partial from inside
+  // a render, while the lock is held:
+  TemplateCache cache(true, [](inja::Environment &env) {
+    env.add_callback("partial", 1, [](inja::Arguments &args) {
+      auto partial_path = filesystem::path(TemplateCache::RenderingPath()).
+        parent_path() / args.at(0)->get<string>();
+      return TemplateCache::Rendering()->render(partial_path.string(), 
+        { {"name", "Bob"} });
+    });
+  });
+
+  write("nested.inja.html", "[{{ partial(\"partial.inja.html\") }}] Hello {{ name }}.");
+  string expected = "[Goodbye Bob.] Hello Alice.";
+
+  // The partial is parsed into our cache on the first render, and is rendered
+  // from there afterwards:
+  EXPECT_EQ(cache.render(path("nested.inja.html"), { {"name", "Alice"} }), expected);
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.render(path("partial.inja.html"), { {"name", "Bob"} }), 
+    "Goodbye Bob.");
+  EXPECT_EQ(cache.render(path("nested.inja.html"), { {"name", "Alice"} }), expected);
+  EXPECT_EQ(cache.size(), 2u);
+
+  // A stale partial replaces the generation, out from under the render that's
+  // nesting it:
+  write("partial.inja.html", "Later {{ name }}.");
+  EXPECT_EQ(cache.render(path("nested.inja.html"), { {"name", "Alice"} }), 
+    "[Later Bob.] Hello Alice.");
+
+  EXPECT_EQ(TemplateCache::Rendering(), nullptr);
+}
+
+TEST_F(TemplateCacheTest, concurrent_nested_renders) {
+  TemplateCache cache(false, [](inja::Environment &env) {
+    env.add_callback("partial", 1, [](inja::Arguments &args) {
+      auto partial_path = filesystem::path(TemplateCache::RenderingPath()).
+        parent_path() / args.at(0)->get<string>();
+      return TemplateCache::Rendering()->render(partial_path.string(), 
+        { {"name", "Bob"} });
+    });
+  });
+
+  write("nested.inja.html", "[{{ partial(\"partial.inja.html\") }}] Hello {{ name }}.");
+  string expected = "[Goodbye Bob.] Hello Alice.";
+
+  // Clearing replaces the generation, while other threads are parsing their 
+  // partials into it:
+  vector<thread> threads;
+  atomic<unsigned int> mismatches(0);
+
+  for (unsigned int i = 0; i < 8; i++)
+    threads.emplace_back([&]() {
+      for (unsigned int j = 0; j < 50; j++) {
+        if (cache.render(path("nested.inja.html"), { {"name", "Alice"} }) != expected)
+          mismatches++;
+        if ((j % 10) == 0) cache.clear();
+      }
+    });
+
+  for (auto &t : threads) t.join();
+
+  EXPECT_EQ(mismatches, 0u);
+}
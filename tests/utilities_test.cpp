@@ -97,3 +97,9 @@ TEST(utilities_test, json_to_tm) {
   EXPECT_EQ(epoch3.tm_gmtoff, (-5 * 3600));
   EXPECT_EQ(tm_to_iso8601(epoch3), "2021-08-28T00:01:05-0500");
 }
+
+TEST(utilities_test, http_date) {
+  EXPECT_EQ(time_to_http_date(1604609654), "Thu, 05 Nov 2020 20:54:14 GMT");
+  EXPECT_EQ(http_date_to_time("Thu, 05 Nov 2020 20:54:14 GMT"), 1604609654);
+  EXPECT_EQ(http_date_to_time("2020-11-05T20:54:14Z"), nullopt);
+}
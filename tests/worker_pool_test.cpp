@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+#include "worker_pool.hpp"
+
+using namespace std;
+
+TEST(WorkerPool, runs_every_task) {
+  atomic<unsigned int> ran(0);
+
+  {
+    WorkerPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    for (unsigned int i = 0; i < 1000; i++) pool.submit([&ran]() { ran++; });
+
+    // Shutdown drains the queues, before it returns:
+    pool.shutdown();
+    EXPECT_EQ(ran, 1000);
+    EXPECT_EQ(pool.pending(), 0);
+  }
+}
+
+TEST(WorkerPool, submit_from_worker) {
+  WorkerPool pool(2);
+  promise<unsigned int> done;
+
+  pool.submit([&pool, &done]() {
+    pool.submit([&done]() { done.set_value(42); });
+  });
+
+  auto result = done.get_future();
+  ASSERT_EQ(result.wait_for(chrono::seconds(5)), future_status::ready);
+  EXPECT_EQ(result.get(), 42);
+}
+
+// A worker that's blocked, has the tasks on its queue stolen by the others:
+TEST(WorkerPool, steals_from_busy_workers) {
+  WorkerPool pool(2);
+  promise<void> release;
+  auto released = release.get_future().share();
+  promise<void> stolen;
+
+  pool.submit([&pool, released, &stolen]() {
+    // This lands on our own queue, behind us:
+    pool.submit([&stolen]() { stolen.set_value(); });
+    released.wait();
+  });
+
+  auto result = stolen.get_future();
+  EXPECT_EQ(result.wait_for(chrono::seconds(5)), future_status::ready);
+  release.set_value();
+}
+
+TEST(WorkerPool, survives_exceptions) {
+  WorkerPool pool(1);
+  promise<void> done;
+
+  pool.submit([]() { throw runtime_error("Whoops"); });
+  pool.submit([&done]() { done.set_value(); });
+
+  EXPECT_EQ(done.get_future().wait_for(chrono::seconds(5)), future_status::ready);
+}
+
+TEST(WorkerPool, requires_a_thread) {
+  EXPECT_THROW(WorkerPool(0), invalid_argument);
+}